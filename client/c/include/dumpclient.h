@@ -0,0 +1,92 @@
+#ifndef DUMPCLIENT_H
+#define DUMPCLIENT_H
+
+/*
+ * libdumpclient: 在进程内提交 dump, 无需落盘再调用 dumpclient.
+ *
+ *     struct dumpclient_options opts = { .server = "10.0.0.1:50051", .codec = "lz4" };
+ *     struct dumpclient* dc = dumpclient_init(&opts);
+ *     const char* md[] = { "rank", "3", "step", "100", NULL };
+ *     dumpclient_submit(dc, "/job/step100/rank3", DUMPCLIENT_FORMAT_BINARY, md,
+ *                       buf, len, free);
+ *     ...
+ *     dumpclient_flush(dc, -1);
+ *     dumpclient_shutdown(dc);
+ *
+ * submit 只入队, 由后台线程发送, 不会阻塞调用方.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DUMPCLIENT_API __attribute__((visibility("default")))
+
+/* 与 DumpRequest.DataFormat 取值一致 */
+enum dumpclient_format {
+    DUMPCLIENT_FORMAT_JSON = 0,
+    DUMPCLIENT_FORMAT_PROTOBUF = 1,
+    DUMPCLIENT_FORMAT_BINARY = 2,
+};
+
+/* 各项为 0 或 NULL 时取默认值 */
+struct dumpclient_options {
+    const char* server;          // 默认 localhost:50051; 逗号分隔的多个地址时按分片键一致性哈希
+    const char* codec;           // none / lz4[:LEVEL] / zstd[:LEVEL], 默认 none
+    int workers;                 // 发送线程数, 默认 2
+    size_t max_queue_bytes;      // 队列中未发送的字节上限, 默认 256MB
+    double bytes_per_sec;        // 带宽限制, 默认不限
+    double requests_per_sec;     // 请求数限制, 默认不限
+    size_t shm_ring_bytes;       // server 为 unix: 地址时经此大小的共享内存环提交
+    const char* queue_dir;       // 服务端不可达时存入此目录下的磁盘队列, 后台补发
+    size_t queue_max_bytes;      // 磁盘队列上限, 超出时丢弃最旧的记录, 默认 1GB
+    const char* payload_type;    // auto / none / mem / timeline / trace, 提取 pid/rank/step
+                                 // 补入 metadata; 默认 auto, 只识别 protobuf
+    const char* shard_keys;      // 逗号分隔的 metadata 键, 决定多个服务端时的去向, 默认 job,rank
+    int aggregate_mem;           // 非 0 时 protobuf 格式的 Mem/ProcMem 在本地合并后再发送
+};
+
+/* 磁盘队列的积压与丢弃情况 */
+struct dumpclient_queue_stats {
+    size_t pending_records;
+    size_t pending_bytes;
+    size_t dropped_records;      // 因容量上限或被服务端拒绝而丢弃
+    size_t dropped_bytes;
+};
+
+struct dumpclient;
+
+/* 连接服务端并启动发送线程, 失败返回 NULL */
+DUMPCLIENT_API struct dumpclient* dumpclient_init(const struct dumpclient_options* opts);
+
+/*
+ * 提交一个 payload. metadata 为 key, value 交替并以 NULL 结尾的数组, 可为 NULL.
+ * free_fn 非 NULL 时接管 buf, 发送完成后调用 free_fn(buf); 否则复制一份.
+ * 队列已满返回 -1 且 errno 为 EAGAIN, 此时 buf 仍归调用方所有.
+ */
+DUMPCLIENT_API int dumpclient_submit(struct dumpclient* dc, const char* dump_path,
+                                     enum dumpclient_format format,
+                                     const char* const* metadata,
+                                     void* buf, size_t len, void (*free_fn)(void*));
+
+/*
+ * 等待已提交的 payload 全部发送完毕, timeout_ms < 0 表示一直等待.
+ * 返回上次 flush 以来发送失败的个数, 超时返回 -1 且 errno 为 ETIMEDOUT.
+ * 配置了 queue_dir 时, 因服务端不可达而转入磁盘队列的不计为失败.
+ */
+DUMPCLIENT_API int dumpclient_flush(struct dumpclient* dc, int timeout_ms);
+
+/* 未配置 queue_dir 时返回 -1 */
+DUMPCLIENT_API int dumpclient_queue_stats(struct dumpclient* dc,
+                                          struct dumpclient_queue_stats* stats);
+
+/* 发送完队列中剩余的 payload 后断开连接并释放资源 */
+DUMPCLIENT_API void dumpclient_shutdown(struct dumpclient* dc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,394 @@
+#include <stdlib.h>
+#include <string.h>
+#include "aggregate.h"
+#include "wire.h"
+
+/* 字段编号, 见 converttool/flamegraph/mem_profile.proto */
+enum { MEM_PROC = 1 };
+enum { PROC_PID = 1, PROC_ALLOCS = 2, PROC_FREES = 3 };
+enum { ALLOC_PTR = 1, ALLOC_STAGE_ID = 2, ALLOC_STAGE_TYPE = 3, ALLOC_SIZE = 4, ALLOC_FRAMES = 5 };
+enum { FREE_PTR = 1 };
+
+struct Buf {
+    uint8_t* data;
+    size_t len;
+    size_t cap;
+};
+
+/* 已释放的 alloc_ptr, 开放寻址, 0 单独记录 */
+struct PtrSet {
+    uint64_t* slots;
+    size_t cap;
+    size_t count;
+    int has_zero;
+};
+
+struct Group {
+    uint64_t stage_id;
+    uint64_t stage_type;
+    uint64_t size;
+    uint64_t hash;
+    size_t stack_off;  // stack_frames 的原始编码在 GroupTable.stacks 中的位置
+    size_t stack_len;
+};
+
+struct GroupTable {
+    struct Group* groups;  // 按首次出现的顺序
+    size_t count;
+    size_t cap;
+    uint32_t* index;  // 0 为空, 否则为 groups 下标 + 1
+    size_t index_cap;
+    struct Buf stacks;
+};
+
+static int buf_reserve(struct Buf* b, size_t n) {
+    if (b->len + n <= b->cap) {
+        return 0;
+    }
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + n) {
+        cap *= 2;
+    }
+    uint8_t* data = realloc(b->data, cap);
+    if (!data) {
+        return -1;
+    }
+    b->data = data;
+    b->cap = cap;
+    return 0;
+}
+
+static int buf_put(struct Buf* b, const void* p, size_t n) {
+    if (n == 0) {
+        return 0;
+    }
+    if (buf_reserve(b, n) < 0) {
+        return -1;
+    }
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+    return 0;
+}
+
+static int buf_put_varint(struct Buf* b, uint64_t v) {
+    if (buf_reserve(b, 10) < 0) {
+        return -1;
+    }
+    b->len += wire_put_varint(b->data + b->len, v);
+    return 0;
+}
+
+static size_t varint_len(uint64_t v) {
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+/* proto3 省略取值为 0 的字段 */
+static int put_varint_field(struct Buf* b, uint32_t number, uint64_t v) {
+    if (v == 0) {
+        return 0;
+    }
+    return buf_put_varint(b, (uint64_t)number << 3 | WT_VARINT) < 0 ? -1 : buf_put_varint(b, v);
+}
+
+static size_t varint_field_len(uint32_t number, uint64_t v) {
+    return v ? varint_len((uint64_t)number << 3) + varint_len(v) : 0;
+}
+
+static int put_len_field(struct Buf* b, uint32_t number, size_t len) {
+    return buf_put_varint(b, (uint64_t)number << 3 | WT_LEN) < 0 ? -1 : buf_put_varint(b, len);
+}
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    return x ^ (x >> 33);
+}
+
+static int ptrset_has(const struct PtrSet* s, uint64_t v) {
+    if (v == 0) {
+        return s->has_zero;
+    }
+    if (s->count == 0) {
+        return 0;
+    }
+    for (size_t i = mix64(v) & (s->cap - 1);; i = (i + 1) & (s->cap - 1)) {
+        if (s->slots[i] == v) {
+            return 1;
+        }
+        if (s->slots[i] == 0) {
+            return 0;
+        }
+    }
+}
+
+static int ptrset_add(struct PtrSet* s, uint64_t v) {
+    if (v == 0) {
+        s->has_zero = 1;
+        return 0;
+    }
+    if ((s->count + 1) * 2 > s->cap) {
+        struct PtrSet grown = { calloc(s->cap ? s->cap * 2 : 1024, sizeof(uint64_t)),
+                                s->cap ? s->cap * 2 : 1024, 0, s->has_zero };
+        if (!grown.slots) {
+            return -1;
+        }
+        for (size_t i = 0; i < s->cap; i++) {
+            if (s->slots[i]) {
+                ptrset_add(&grown, s->slots[i]);
+            }
+        }
+        free(s->slots);
+        *s = grown;
+    }
+    size_t i = mix64(v) & (s->cap - 1);
+    while (s->slots[i] && s->slots[i] != v) {
+        i = (i + 1) & (s->cap - 1);
+    }
+    if (!s->slots[i]) {
+        s->slots[i] = v;
+        s->count++;
+    }
+    return 0;
+}
+
+static uint64_t stack_hash(uint64_t stage_type, uint64_t stage_id, const uint8_t* p, size_t len) {
+    uint64_t h = mix64(stage_type * 0x9e3779b97f4a7c15ULL + stage_id);
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static int table_grow(struct GroupTable* t) {
+    size_t cap = t->index_cap ? t->index_cap * 2 : 1024;
+    uint32_t* index = calloc(cap, sizeof(*index));
+    if (!index) {
+        return -1;
+    }
+    for (size_t g = 0; g < t->count; g++) {
+        size_t i = t->groups[g].hash & (cap - 1);
+        while (index[i]) {
+            i = (i + 1) & (cap - 1);
+        }
+        index[i] = (uint32_t)(g + 1);
+    }
+    free(t->index);
+    t->index = index;
+    t->index_cap = cap;
+    return 0;
+}
+
+static struct Group* table_find(struct GroupTable* t, uint64_t stage_type, uint64_t stage_id,
+                                const uint8_t* stack, size_t stack_len) {
+    if ((t->count + 1) * 2 > t->index_cap && table_grow(t) < 0) {
+        return NULL;
+    }
+    uint64_t hash = stack_hash(stage_type, stage_id, stack, stack_len);
+    size_t i = hash & (t->index_cap - 1);
+    for (; t->index[i]; i = (i + 1) & (t->index_cap - 1)) {
+        struct Group* g = &t->groups[t->index[i] - 1];
+        if (g->hash == hash && g->stage_type == stage_type && g->stage_id == stage_id &&
+            g->stack_len == stack_len &&
+            (stack_len == 0 || memcmp(t->stacks.data + g->stack_off, stack, stack_len) == 0)) {
+            return g;
+        }
+    }
+
+    if (t->count == t->cap) {
+        size_t cap = t->cap ? t->cap * 2 : 256;
+        struct Group* groups = realloc(t->groups, cap * sizeof(*groups));
+        if (!groups) {
+            return NULL;
+        }
+        t->groups = groups;
+        t->cap = cap;
+    }
+    struct Group* g = &t->groups[t->count];
+    g->stage_type = stage_type;
+    g->stage_id = stage_id;
+    g->size = 0;
+    g->hash = hash;
+    g->stack_off = t->stacks.len;
+    g->stack_len = stack_len;
+    if (buf_put(&t->stacks, stack, stack_len) < 0) {
+        return NULL;
+    }
+    t->index[i] = (uint32_t)(++t->count);
+    return g;
+}
+
+/* 读取一条 MemAllocEntry, stack_frames 各字段的原始编码依次拼入 stack */
+static int parse_alloc(const uint8_t* p, const uint8_t* end, uint64_t v[ALLOC_FRAMES],
+                       struct Buf* stack) {
+    memset(v, 0, sizeof(uint64_t) * ALLOC_FRAMES);
+    stack->len = 0;
+    struct WireField f;
+    while (p < end) {
+        if (wire_next_field(&p, end, &f) < 0) {
+            return -1;
+        }
+        if (f.number == ALLOC_FRAMES) {
+            if (f.wire_type != WT_LEN || buf_put(stack, f.start, (size_t)(p - f.start)) < 0) {
+                return -1;
+            }
+        } else if (f.number < ALLOC_FRAMES) {
+            if (f.wire_type != WT_VARINT) {
+                return -1;
+            }
+            v[f.number] = f.value;
+        }
+    }
+    return 0;
+}
+
+/* 合并一个 ProcMem, 结果 (ProcMem 的消息体) 追加到 out */
+static int aggregate_proc(const uint8_t* payload, size_t len, struct Buf* out,
+                          struct AggregateStats* stats) {
+    const uint8_t* end = payload + len;
+    struct PtrSet freed = {0};
+    struct GroupTable table = {0};
+    struct Buf stack = {0};
+    uint64_t pid = 0;
+    int ret = -1;
+
+    const uint8_t* p = payload;
+    struct WireField f;
+    while (p < end) {
+        if (wire_next_field(&p, end, &f) < 0) {
+            goto out;
+        }
+        if (f.number == PROC_PID) {
+            if (f.wire_type != WT_VARINT) {
+                goto out;
+            }
+            pid = f.value;
+        } else if (f.number == PROC_ALLOCS || f.number == PROC_FREES) {
+            if (f.wire_type != WT_LEN) {
+                goto out;
+            }
+        }
+        if (f.number != PROC_FREES) {
+            continue;
+        }
+        const uint8_t* q = f.data;
+        struct WireField g;
+        uint64_t ptr = 0;
+        while (q < f.data + f.len) {
+            if (wire_next_field(&q, f.data + f.len, &g) < 0) {
+                goto out;
+            }
+            if (g.number == FREE_PTR && g.wire_type == WT_VARINT) {
+                ptr = g.value;
+            }
+        }
+        if (ptrset_add(&freed, ptr) < 0) {
+            goto out;
+        }
+    }
+
+    p = payload;
+    while (p < end) {
+        wire_next_field(&p, end, &f);
+        if (f.number != PROC_ALLOCS) {
+            continue;
+        }
+        uint64_t v[ALLOC_FRAMES];
+        if (parse_alloc(f.data, f.data + f.len, v, &stack) < 0) {
+            goto out;
+        }
+        stats->allocs++;
+        if (ptrset_has(&freed, v[ALLOC_PTR])) {
+            stats->freed++;
+            continue;
+        }
+        struct Group* g = table_find(&table, v[ALLOC_STAGE_TYPE], v[ALLOC_STAGE_ID], stack.data,
+                                     stack.len);
+        if (!g) {
+            goto out;
+        }
+        g->size += v[ALLOC_SIZE];
+    }
+
+    if (put_varint_field(out, PROC_PID, pid) < 0) {
+        goto out;
+    }
+    for (size_t i = 0; i < table.count; i++) {
+        const struct Group* g = &table.groups[i];
+        size_t entry_len = varint_field_len(ALLOC_STAGE_ID, g->stage_id) +
+                           varint_field_len(ALLOC_STAGE_TYPE, g->stage_type) +
+                           varint_field_len(ALLOC_SIZE, g->size) + g->stack_len;
+        if (put_len_field(out, PROC_ALLOCS, entry_len) < 0 ||
+            put_varint_field(out, ALLOC_STAGE_ID, g->stage_id) < 0 ||
+            put_varint_field(out, ALLOC_STAGE_TYPE, g->stage_type) < 0 ||
+            put_varint_field(out, ALLOC_SIZE, g->size) < 0 ||
+            buf_put(out, table.stacks.data + g->stack_off, g->stack_len) < 0) {
+            goto out;
+        }
+    }
+    stats->stacks += table.count;
+    ret = 0;
+
+out:
+    free(freed.slots);
+    free(table.groups);
+    free(table.index);
+    free(table.stacks.data);
+    free(stack.data);
+    return ret;
+}
+
+int aggregate_mem(const uint8_t* payload, size_t len, uint8_t** out, size_t* out_len,
+                  struct AggregateStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (len == 0) {
+        return -1;
+    }
+
+    /* Mem 只有 proc_mem 一个长度字段; 裸 ProcMem 的 pid 是 varint */
+    int is_mem = 1;
+    int is_proc = 1;
+    const uint8_t* p = payload;
+    const uint8_t* end = payload + len;
+    struct WireField f;
+    while (p < end) {
+        if (wire_next_field(&p, end, &f) < 0) {
+            return -1;
+        }
+        is_mem &= f.number == MEM_PROC && f.wire_type == WT_LEN;
+        is_proc &= (f.number == PROC_PID && f.wire_type == WT_VARINT) ||
+                   ((f.number == PROC_ALLOCS || f.number == PROC_FREES) && f.wire_type == WT_LEN);
+    }
+    if (!is_mem && !is_proc) {
+        return -1;
+    }
+
+    struct Buf buf = {0};
+    struct Buf body = {0};
+    int ret = buf_reserve(&buf, 1);
+    if (is_proc) {
+        ret = ret < 0 ? -1 : aggregate_proc(payload, len, &buf, stats);
+    }
+    for (p = payload; is_mem && ret == 0 && p < end;) {
+        wire_next_field(&p, end, &f);
+        body.len = 0;
+        if (aggregate_proc(f.data, f.len, &body, stats) < 0 ||
+            put_len_field(&buf, MEM_PROC, body.len) < 0 || buf_put(&buf, body.data, body.len) < 0) {
+            ret = -1;
+        }
+    }
+    free(body.data);
+    if (ret < 0) {
+        free(buf.data);
+        return -1;
+    }
+    *out = buf.data;
+    *out_len = buf.len;
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef DUMPCLIENT_AGGREGATE_H
+#define DUMPCLIENT_AGGREGATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct AggregateStats {
+    size_t allocs;  // 原始分配记录数
+    size_t freed;   // alloc_ptr 已释放而丢弃的
+    size_t stacks;  // 合并后的条目数
+};
+
+/*
+ * 在本地合并 Mem 或裸 ProcMem (converttool/flamegraph/mem_profile.proto):
+ * 丢弃 alloc_ptr 出现在 mem_free_stacks 中的分配, 同一 ProcMem 内 stage_type, stage_id
+ * 和 stack_frames 都相同的分配合并为一条, mem_size 为总和, 不再附带释放记录.
+ * 输出仍是同一 schema, 转换脚本由此构建的调用树与原始数据相同.
+ * 成功返回 0, *out 由调用方 free; 不是该格式或编码不合法时返回 -1.
+ */
+int aggregate_mem(const uint8_t* payload, size_t len, uint8_t** out, size_t* out_len,
+                  struct AggregateStats* stats);
+
+#endif
@@ -0,0 +1,436 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glob.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "client.h"
+#include "reader.h"
+
+#define READ_DEPTH 32
+#define READ_BUF_SIZE (256 * 1024)  // 不超过此大小的文件经 io_uring 预读, 更大的仍用 mmap
+
+struct Batch {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int inflight;
+    struct Session* session;  // 非空时小文件经会话发送
+    size_t files_ok;
+    size_t files_failed;
+    size_t files_dedup;
+    size_t files_queued;
+    size_t raw_bytes;
+    size_t wire_bytes;
+};
+
+struct BatchItem {
+    struct Batch* batch;
+    const struct CmdArgs* args;
+    struct Limiter* limiter;
+    char* filename;
+    char* dump_path;
+    uint8_t* payload;
+    size_t len;
+    struct FileReader* reader;
+    struct ReadBuf* rbuf;  // 经 reader 读入时 payload 指向其缓冲区
+    struct Shard* shard;  // 分片时发往的服务端
+    uint8_t* merged;  // 本地合并后的 payload, 原始数据已归还
+    struct CmdArgs merged_args;
+    struct RoutedArgs routed;
+    struct DumpCall call;
+    struct ShmRing* shm;  // 经共享内存环提交时非空
+    struct ShmCall shm_call;
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void batch_complete(struct Batch* batch, const struct CodecStats* stats, int ok) {
+    pthread_mutex_lock(&batch->lock);
+    if (ok) {
+        batch->files_ok++;
+        batch->raw_bytes += stats->raw_bytes;
+        batch->wire_bytes += stats->wire_bytes;
+    } else {
+        batch->files_failed++;
+    }
+    batch->inflight--;
+    pthread_cond_signal(&batch->cond);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+static void batch_dedup(struct Batch* batch, size_t len) {
+    pthread_mutex_lock(&batch->lock);
+    batch->files_ok++;
+    batch->files_dedup++;
+    batch->raw_bytes += len;
+    batch->inflight--;
+    pthread_cond_signal(&batch->cond);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+static void batch_queued(struct Batch* batch) {
+    pthread_mutex_lock(&batch->lock);
+    batch->files_queued++;
+    batch->inflight--;
+    pthread_cond_signal(&batch->cond);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+static void batch_failed(struct Batch* batch) {
+    pthread_mutex_lock(&batch->lock);
+    batch->files_failed++;
+    pthread_mutex_unlock(&batch->lock);
+}
+
+static void free_item(struct BatchItem* item) {
+    release_call(&item->call);
+    if (item->shm) {
+        shm_ring_release(item->shm, &item->shm_call.slot);
+    }
+    if (item->merged) {
+        free(item->merged);
+    } else if (item->rbuf) {
+        reader_release(item->reader, item->rbuf);
+    } else {
+        unload_payload(item->payload, item->len);
+    }
+    free(item->dump_path);
+    free(item);
+}
+
+/* 服务端未应答时摘除其分片; 未应答或繁忙时存入磁盘队列 */
+static void finish_item(struct BatchItem* item, int answered, int busy, int ok) {
+    const struct CmdArgs* args = item->args;
+    struct Batch* batch = item->batch;
+    struct CodecStats stats = item->call.stats;
+    if (item->shard) {
+        shard_report(args->shards, item->shard, answered);
+    }
+    int queued = (!answered || busy) && args->queue &&
+                 queue_append(args->queue, item->dump_path, args->format, &args->metadata,
+                              item->payload, item->len) == 0;
+
+    /* 先归还缓冲区再计数, 计数归零后主线程即销毁 reader */
+    free_item(item);
+    if (queued) {
+        batch_queued(batch);
+    } else {
+        batch_complete(batch, &stats, ok);
+    }
+}
+
+static void batch_done(grpc_c_context_t* ctx, void* tag, int success) {
+    struct BatchItem* item = tag;
+    Dumptool__V1__DumpResponse* resp = NULL;
+    int ok = 0;
+    int answered = 0;
+    int busy = 0;
+
+    if (success && ctx->gcc_stream->read(ctx, (void**)&resp, 0, -1) == GRPC_C_OK && resp) {
+        ok = resp->success;
+        answered = 1;
+        busy = server_busy(resp);
+        /* 改为不压缩后, 与繁忙时一样存入磁盘队列重发 */
+        if (resp->compression_unsupported &&
+            item->call.req.compression != DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__NONE) {
+            codec_disable(&item->args->codec);
+            busy = 1;
+        }
+        limiter_backoff(item->limiter, resp->retry_after_ms);
+        if (!ok) {
+            fprintf(stderr, "%s: %s\n", item->filename, resp->message);
+        }
+        dumptool__v1__dump_response__free_unpacked(resp, NULL);
+    } else {
+        fprintf(stderr, "%s: SendDump failed\n", item->filename);
+    }
+
+    grpc_c_status_t status;
+    ctx->gcc_stream->finish(ctx, &status, 0);
+    finish_item(item, answered, busy, ok);
+}
+
+static void session_done(void* tag, int answered, int ok, const char* message) {
+    struct BatchItem* item = tag;
+    if (answered && !ok) {
+        fprintf(stderr, "%s: %s\n", item->filename, message);
+    }
+    finish_item(item, answered, 0, ok);
+}
+
+/* 目录展开为其下的所有文件, 否则按 glob 模式匹配 */
+static int expand_files(const char* spec, glob_t* files) {
+    struct stat st;
+    char pattern[4096];
+    if (stat(spec, &st) == 0 && S_ISDIR(st.st_mode)) {
+        snprintf(pattern, sizeof(pattern), "%s/*", spec);
+    } else {
+        snprintf(pattern, sizeof(pattern), "%s", spec);
+    }
+
+    int ret = glob(pattern, 0, NULL, files);
+    if (ret == GLOB_NOMATCH) {
+        fprintf(stderr, "No files match %s\n", spec);
+        return -1;
+    }
+    if (ret != 0) {
+        fprintf(stderr, "Failed to expand %s\n", spec);
+        return -1;
+    }
+    return 0;
+}
+
+/* 会话的完成回调在本线程中执行, 在途数由会话自己限制, 这里只计数 */
+static void acquire_slot(struct Batch* batch, int limit) {
+    pthread_mutex_lock(&batch->lock);
+    while (!batch->session && batch->inflight >= limit) {
+        pthread_cond_wait(&batch->cond, &batch->lock);
+    }
+    batch->inflight++;
+    pthread_mutex_unlock(&batch->lock);
+}
+
+static struct BatchItem* new_item(const struct CmdArgs* args, struct Batch* batch,
+                                  char* filename, char* dump_path) {
+    struct BatchItem* item = calloc(1, sizeof(*item));
+    if (!item) {
+        free(dump_path);
+        return NULL;
+    }
+    item->batch = batch;
+    item->args = args;
+    item->limiter = args->limiter;
+    item->filename = filename;
+    item->dump_path = dump_path;
+    return item;
+}
+
+/* payload 已就绪, 占用异步窗口的一个位置后发出 */
+static void start_item(grpc_c_client_t* client, const struct CmdArgs* args,
+                       struct Batch* batch, struct BatchItem* item) {
+    char* filename = item->filename;
+    char* dump_path = item->dump_path;
+    uint8_t* payload = item->payload;
+    size_t len = item->len;
+    args = aggregate_payload(args, &payload, &len, &item->merged_args);
+    if (payload != item->payload) {
+        if (item->rbuf) {
+            reader_release(item->reader, item->rbuf);
+        } else {
+            unload_payload(item->payload, item->len);
+        }
+        item->payload = item->merged = payload;
+        item->len = len;
+    }
+    args = item->args = route_payload(args, item->payload, item->len, &item->routed);
+    acquire_slot(batch, args->inflight);
+    if (args->shards) {
+        item->shard = shard_pick(args->shards, &args->metadata, dump_path);
+        if (!item->shard) {
+            fprintf(stderr, "%s: no server available\n", filename);
+            finish_item(item, 0, 0, 0);
+            return;
+        }
+        client = item->shard->client;
+    }
+    if (args->dedup && probe_dump(client, args, dump_path, item->payload, item->len) == 1) {
+        batch_dedup(batch, item->len);
+        free_item(item);
+        return;
+    }
+
+    if (batch->session) {
+        if (prepare_request(args, dump_path, item->payload, item->len, &item->call) < 0) {
+            batch_complete(batch, &item->call.stats, 0);
+            free_item(item);
+            return;
+        }
+        session_send(batch->session, &item->call.req, item);
+        return;
+    }
+
+    int status;
+    if (shm_fits(args, item->len)) {
+        item->call.stats.raw_bytes = item->call.stats.wire_bytes = item->len;
+        if (prepare_shm_request(args, dump_path, item->payload, item->len,
+                                &item->shm_call) < 0) {
+            batch_complete(batch, &item->call.stats, 0);
+            free_item(item);
+            return;
+        }
+        item->shm = args->shm;
+        limiter_acquire(args->limiter, 0);
+        status = dumptool__v1__dump_service__send_shm_dump__async(
+            client, NULL, 0, &item->shm_call.req, batch_done, item);
+    } else {
+        if (prepare_request(args, dump_path, item->payload, item->len, &item->call) < 0) {
+            batch_complete(batch, &item->call.stats, 0);
+            free_item(item);
+            return;
+        }
+        limiter_acquire(args->limiter, item->call.req.payload.len);
+        status = dumptool__v1__dump_service__send_dump__async(client, NULL, 0, &item->call.req,
+                                                              batch_done, item);
+    }
+    if (status != GRPC_C_OK) {
+        fprintf(stderr, "%s: SendDump failed to start\n", filename);
+        batch_complete(batch, &item->call.stats, 0);
+        free_item(item);
+    }
+}
+
+static int submit_file(grpc_c_client_t* client, const struct CmdArgs* args,
+                       struct Batch* batch, char* filename, char* dump_path) {
+    struct BatchItem* item = new_item(args, batch, filename, dump_path);
+    if (!item) {
+        return -1;
+    }
+    if (load_payload(filename, &item->payload, &item->len) < 0) {
+        free_item(item);
+        return -1;
+    }
+    start_item(client, args, batch, item);
+    return 0;
+}
+
+/* 预读完成的小文件, 缓冲区随 item 释放时归还 */
+static void start_read(grpc_c_client_t* client, const struct CmdArgs* args,
+                       struct Batch* batch, struct ReadBuf* rbuf) {
+    struct BatchItem* item = rbuf->tag;
+    item->rbuf = rbuf;
+    if (rbuf->err) {
+        fprintf(stderr, "%s: read failed: %s\n", item->filename, strerror(rbuf->err));
+        batch_failed(batch);
+        free_item(item);
+        return;
+    }
+    item->payload = rbuf->data;
+    item->len = rbuf->len;
+    start_item(client, args, batch, item);
+}
+
+int run_batch(grpc_c_client_t* client, const struct CmdArgs* args) {
+    glob_t files;
+    if (expand_files(args->batch, &files) < 0) {
+        return -1;
+    }
+
+    /* 预读的 payload 在 reader 的缓冲区中, 不能按文件映射处理 */
+    struct CmdArgs read_args = *args;
+    read_args.heap_payload = 1;
+    struct FileReader reader;
+    if (reader_init(&reader, READ_DEPTH, READ_DEPTH + args->inflight, READ_BUF_SIZE) < 0) {
+        globfree(&files);
+        return -1;
+    }
+
+    struct Batch batch = {0};
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_cond_init(&batch.cond, NULL);
+    struct Session session;
+    if (args->session) {
+        if (session_open(&session, client, args, session_done) == 0) {
+            batch.session = &session;
+        } else {
+            fprintf(stderr, "DumpSession unavailable, falling back to SendDump\n");
+        }
+    }
+
+    double start = now_sec();
+    for (size_t i = 0; i < files.gl_pathc; i++) {
+        char* filename = files.gl_pathv[i];
+        struct stat st;
+        if (stat(filename, &st) < 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        char* dump_path = join_dump_path(args->dump_path, filename);
+        if (!dump_path) {
+            batch_failed(&batch);
+            continue;
+        }
+
+        /* 大文件走分块上传, 同步完成, 不占用异步窗口 */
+        if (args->stream || (size_t)st.st_size > STREAM_THRESHOLD) {
+            struct CodecStats stats = { (size_t)st.st_size, (size_t)st.st_size, 0 };
+            acquire_slot(&batch, args->inflight);
+            int ret = send_file(client, args, filename, dump_path);
+            if (ret == SEND_DEDUP) {
+                batch_dedup(&batch, stats.raw_bytes);
+            } else if (ret == SEND_QUEUED) {
+                batch_queued(&batch);
+            } else {
+                batch_complete(&batch, &stats, ret == 0);
+            }
+            free(dump_path);
+            continue;
+        }
+
+        if ((size_t)st.st_size > READ_BUF_SIZE) {
+            if (submit_file(client, args, &batch, filename, dump_path) < 0) {
+                batch_failed(&batch);
+            }
+            continue;
+        }
+
+        struct BatchItem* item = new_item(&read_args, &batch, filename, dump_path);
+        if (!item) {
+            batch_failed(&batch);
+            continue;
+        }
+        item->reader = &reader;
+        struct ReadBuf* rbuf;
+        while (reader.inflight >= READ_DEPTH && (rbuf = reader_next(&reader, 1)) != NULL) {
+            start_read(client, &read_args, &batch, rbuf);
+        }
+        reader_submit(&reader, filename, (size_t)st.st_size, item);
+        while ((rbuf = reader_next(&reader, 0)) != NULL) {
+            start_read(client, &read_args, &batch, rbuf);
+        }
+    }
+    struct ReadBuf* rbuf;
+    while ((rbuf = reader_next(&reader, 1)) != NULL) {
+        start_read(client, &read_args, &batch, rbuf);
+    }
+    if (batch.session) {
+        session_close(batch.session);
+    }
+
+    pthread_mutex_lock(&batch.lock);
+    while (batch.inflight > 0) {
+        pthread_cond_wait(&batch.cond, &batch.lock);
+    }
+    pthread_mutex_unlock(&batch.lock);
+    double elapsed = now_sec() - start;
+
+    size_t total = batch.files_ok + batch.files_failed + batch.files_queued;
+    printf("Batch: %zu files (%zu failed), %.2f MB in %.3f s\n",
+           total, batch.files_failed, batch.raw_bytes / 1e6, elapsed);
+    if (elapsed > 0 && total > 0) {
+        printf("Throughput: %.1f files/s, %.2f MB/s, %.1f us/file\n",
+               total / elapsed, batch.raw_bytes / 1e6 / elapsed, elapsed * 1e6 / total);
+    }
+    if (batch.session) {
+        print_session_stats(&session);
+    }
+    if (batch.files_queued > 0) {
+        printf("Queued: %zu files for retry in %s\n", batch.files_queued, args->queue->dir);
+    }
+    if (args->dedup) {
+        printf("Dedup: %zu files already stored on the server\n", batch.files_dedup);
+    }
+    if (args->codec.type != DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__NONE) {
+        printf("Wire: %.2f MB (%s)\n", batch.wire_bytes / 1e6, codec_name(&args->codec));
+    }
+
+    pthread_mutex_destroy(&batch.lock);
+    pthread_cond_destroy(&batch.cond);
+    reader_destroy(&reader);
+    globfree(&files);
+    return batch.files_failed == 0 ? 0 : -1;
+}
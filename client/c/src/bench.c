@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "client.h"
+
+#define BENCH_PATH_LEN 256
+
+struct Bench {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int inflight;
+    size_t failed;
+    size_t completed;
+    uint64_t* latency_us;
+};
+
+struct BenchCall {
+    struct Bench* bench;
+    uint64_t start_us;
+    Dumptool__V1__DumpRequest req;
+    Dumptool__V1__ShmDumpRequest shm_req;
+    char dump_path[BENCH_PATH_LEN];
+};
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void bench_finish(struct Bench* bench, uint64_t latency, int ok) {
+    pthread_mutex_lock(&bench->lock);
+    if (ok) {
+        bench->latency_us[bench->completed++] = latency;
+    } else {
+        bench->failed++;
+    }
+    bench->inflight--;
+    pthread_cond_signal(&bench->cond);
+    pthread_mutex_unlock(&bench->lock);
+}
+
+static void bench_done(grpc_c_context_t* ctx, void* tag, int success) {
+    struct BenchCall* call = tag;
+    Dumptool__V1__DumpResponse* resp = NULL;
+    int ok = 0;
+    if (success && ctx->gcc_stream->read(ctx, (void**)&resp, 0, -1) == GRPC_C_OK && resp) {
+        ok = resp->success;
+        dumptool__v1__dump_response__free_unpacked(resp, NULL);
+    }
+    grpc_c_status_t status;
+    ctx->gcc_stream->finish(ctx, &status, 0);
+    bench_finish(call->bench, now_us() - call->start_us, ok);
+    free(call);
+}
+
+static void bench_session_done(void* tag, int answered, int ok, const char* message) {
+    (void)message;
+    struct BenchCall* call = tag;
+    bench_finish(call->bench, now_us() - call->start_us, answered && ok);
+    free(call);
+}
+
+/* xorshift 填充, 内容不可压缩, 压缩开销按最坏情况计 */
+static uint8_t* make_payload(size_t len) {
+    uint8_t* buf = malloc(len ? len : 1);
+    uint64_t x = 0x9e3779b97f4a7c15ULL;
+    for (size_t i = 0; buf && i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        buf[i] = (uint8_t)x;
+    }
+    return buf;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t percentile(const uint64_t* sorted, size_t n, double p) {
+    size_t rank = (size_t)(p * n + 0.999999);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+int run_bench(grpc_c_client_t* client, const struct CmdArgs* args) {
+    uint8_t* payload = make_payload(args->bench_size);
+    struct Bench bench = {0};
+    bench.latency_us = malloc(args->bench_count * sizeof(*bench.latency_us));
+    /* 共享内存模式下所有请求引用环中同一段数据, 每次请求不再复制 */
+    int use_shm = shm_fits(args, args->bench_size);
+    struct DumpCall proto;
+    struct ShmCall shm_proto = {0};
+    if (!payload || !bench.latency_us ||
+        prepare_request(args, args->dump_path, payload, args->bench_size, &proto) < 0) {
+        free(payload);
+        free(bench.latency_us);
+        return -1;
+    }
+    if (use_shm && prepare_shm_request(args, args->dump_path, payload, args->bench_size,
+                                       &shm_proto) < 0) {
+        use_shm = 0;
+    }
+    pthread_mutex_init(&bench.lock, NULL);
+    pthread_cond_init(&bench.cond, NULL);
+    /* 会话的完成回调在本线程中执行, 在途数由会话限制 */
+    struct Session session;
+    int use_session = 0;
+    if (args->session) {
+        use_session = session_open(&session, client, args, bench_session_done) == 0;
+        if (!use_session) {
+            fprintf(stderr, "DumpSession unavailable, falling back to SendDump\n");
+        }
+    }
+
+    uint64_t start = now_us();
+    for (size_t i = 0; i < args->bench_count; i++) {
+        struct BenchCall* call = malloc(sizeof(*call));
+        if (!call) {
+            bench.failed++;
+            continue;
+        }
+        call->bench = &bench;
+        call->req = proto.req;
+        call->shm_req = shm_proto.req;
+        snprintf(call->dump_path, sizeof(call->dump_path), "%s/bench-%zu",
+                 args->dump_path, i);
+        call->req.dump_path = call->dump_path;
+        call->shm_req.dump_path = call->dump_path;
+
+        pthread_mutex_lock(&bench.lock);
+        while (!use_session && bench.inflight >= args->inflight) {
+            pthread_cond_wait(&bench.cond, &bench.lock);
+        }
+        bench.inflight++;
+        pthread_mutex_unlock(&bench.lock);
+
+        if (use_session) {
+            call->start_us = now_us();
+            session_send(&session, &call->req, call);
+            continue;
+        }
+        limiter_acquire(args->limiter, use_shm ? 0 : call->req.payload.len);
+        call->start_us = now_us();
+        int status = use_shm
+            ? dumptool__v1__dump_service__send_shm_dump__async(client, NULL, 0, &call->shm_req,
+                                                               bench_done, call)
+            : dumptool__v1__dump_service__send_dump__async(client, NULL, 0, &call->req,
+                                                           bench_done, call);
+        if (status != GRPC_C_OK) {
+            bench_finish(&bench, 0, 0);
+            free(call);
+        }
+    }
+
+    if (use_session) {
+        session_close(&session);
+    }
+    pthread_mutex_lock(&bench.lock);
+    while (bench.inflight > 0) {
+        pthread_cond_wait(&bench.cond, &bench.lock);
+    }
+    pthread_mutex_unlock(&bench.lock);
+    double elapsed = (now_us() - start) / 1e6;
+
+    size_t n = bench.completed;
+    printf("Bench: %zu requests x %zu bytes%s, concurrency %d, %zu failed, %.3f s\n",
+           args->bench_count, args->bench_size,
+           use_shm ? " via shm" : use_session ? " via session" : "", args->inflight,
+           bench.failed, elapsed);
+    if (n > 0 && elapsed > 0) {
+        qsort(bench.latency_us, n, sizeof(*bench.latency_us), cmp_u64);
+        printf("Throughput: %.1f req/s, %.2f MB/s\n",
+               n / elapsed, (double)n * args->bench_size / 1e6 / elapsed);
+        printf("Latency (us): p50 %lu, p90 %lu, p99 %lu, p999 %lu, max %lu\n",
+               (unsigned long)percentile(bench.latency_us, n, 0.50),
+               (unsigned long)percentile(bench.latency_us, n, 0.90),
+               (unsigned long)percentile(bench.latency_us, n, 0.99),
+               (unsigned long)percentile(bench.latency_us, n, 0.999),
+               (unsigned long)bench.latency_us[n - 1]);
+    }
+    if (use_session) {
+        print_session_stats(&session);
+    }
+    if (!use_shm) {
+        print_codec_stats(&args->codec, &proto.stats, 0);
+    } else {
+        release_shm_call(args, &shm_proto);
+    }
+
+    pthread_mutex_destroy(&bench.lock);
+    pthread_cond_destroy(&bench.cond);
+    release_call(&proto);
+    free(bench.latency_us);
+    free(payload);
+    return bench.failed == 0 ? 0 : -1;
+}
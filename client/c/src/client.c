@@ -2,39 +2,445 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <grpc/grpc.h>
 #include <grpc/support/log.h>
-#include "generated/dumptool.pb-c.h"
-#include "generated/dumptool.grpc-c.h"
+#include "client.h"
+#include "aggregate.h"
 
-#define DEFAULT_SERVER   "localhost:50051"
-#define MAX_FILE_SIZE    (1024 * 1024 * 100) // 100MB限制
+#define CODEC_CHECK_TIMEOUT_MS 2000
 
-struct CmdArgs {
-    char* server;
-    char* dump_path;
-    char* input_file;
-    Dumptool__V1__DumpRequest__DataFormat format;
-};
+/*
+ * 以只读方式映射整个文件, 由调用方用 unload_payload 释放.
+ * payload 直接指向映射区, 不经过堆缓冲, 页面按需从 page cache 读入.
+ */
+int load_payload(const char* filename, uint8_t** buf, size_t* len) {
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror("File open failed");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        perror("File stat failed");
+        close(fd);
+        return -1;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Not a regular file: %s\n", filename);
+        close(fd);
+        return -1;
+    }
+
+    *buf = NULL;
+    *len = (size_t)st.st_size;
+    if (*len == 0) {
+        close(fd);
+        return 0;
+    }
+
+    void* addr = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        perror("File mmap failed");
+        return -1;
+    }
+    madvise(addr, *len, MADV_SEQUENTIAL);
 
-void print_usage(const char* prog_name) {
-    printf("Usage: %s -p PATH -i FILE [OPTIONS]\n\n", prog_name);
-    printf("Options:\n");
-    printf("  -s ADDRESS  Server address (default: %s)\n", DEFAULT_SERVER);
-    printf("  -f FORMAT   Data format (json/protobuf/binary)\n");
-    printf("  -h          Show this help\n");
+    *buf = addr;
+    return 0;
 }
 
-int load_payload(const char* filename, uint8_t** buf, size_t* len) {
-    FILE* fp = fopen(filename, "rb");
-    if (!fp) {
-        perror("File open failed");
+void unload_payload(uint8_t* buf, size_t len) {
+    if (buf && len > 0) {
+        munmap(buf, len);
+    }
+}
+
+void print_codec_stats(const struct Codec* codec, const struct CodecStats* stats,
+                       uint64_t server_cpu_us) {
+    if (codec->type == DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__NONE) {
+        return;
+    }
+    long saved = (long)stats->raw_bytes - (long)stats->wire_bytes;
+    double ratio = stats->raw_bytes ? 100.0 * saved / stats->raw_bytes : 0.0;
+    printf("Compression: %s:%d, %zu -> %zu bytes (saved %ld, %.1f%%), "
+           "cpu %lu us, server decode %lu us\n",
+           codec_name(codec), codec->level, stats->raw_bytes, stats->wire_bytes,
+           saved, ratio, (unsigned long)stats->cpu_us, (unsigned long)server_cpu_us);
+}
+
+/* 服务端未列出所选算法时不压缩; 不可达或未返回列表时沿用, 由发送时的应答兜底 */
+static void check_codec(grpc_c_client_t* client, const struct CmdArgs* args) {
+    Dumptool__V1__StatsRequest req;
+    dumptool__v1__stats_request__init(&req);
+    Dumptool__V1__StatsResponse* resp = NULL;
+    if (dumptool__v1__dump_service__get_stats(client, NULL, 0, &req, &resp, NULL,
+                                              CODEC_CHECK_TIMEOUT_MS) != GRPC_C_OK || !resp) {
+        return;
+    }
+    int found = resp->n_compressions == 0;
+    for (size_t i = 0; i < resp->n_compressions; i++) {
+        found |= resp->compressions[i] == args->codec.type;
+    }
+    dumptool__v1__stats_response__free_unpacked(resp, NULL);
+    if (!found) {
+        codec_disable(&args->codec);
+    }
+}
+
+void negotiate_codec(grpc_c_client_t* client, const struct CmdArgs* args) {
+    if (args->codec.type == DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__NONE) {
+        return;
+    }
+    if (!args->shards) {
+        check_codec(client, args);
+        return;
+    }
+    for (int i = 0; i < args->shards->count; i++) {
+        check_codec(args->shards->shards[i].client, args);
+    }
+}
+
+void release_pages(const struct CmdArgs* args, uint8_t* base, size_t offset, size_t len) {
+    if (args->heap_payload) {
+        return;
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = (offset + page - 1) & ~(page - 1);
+    size_t end = (offset + len) & ~(page - 1);
+    if (end > start) {
+        madvise(base + start, end - start, MADV_DONTNEED);
+    }
+}
+
+int prepare_request(const struct CmdArgs* args, const char* dump_path,
+                    uint8_t* payload, size_t len, struct DumpCall* call) {
+    Dumptool__V1__DumpRequest* req = &call->req;
+    dumptool__v1__dump_request__init(req);
+    req->dump_path = (char*)dump_path;
+    req->format = args->format;
+    req->payload.data = payload;
+    req->payload.len = len;
+    req->raw_size = len;
+    FILL_METADATA(req, call->entries, call->ptrs,
+                  dumptool__v1__dump_request__metadata_entry__init, &args->metadata);
+
+    const struct Codec* codec = codec_active(&args->codec);
+    call->stats.raw_bytes = call->stats.wire_bytes = len;
+    call->stats.cpu_us = 0;
+    call->buf = NULL;
+    if (codec->type == DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__NONE) {
+        return 0;
+    }
+
+    size_t cap = codec_bound(codec, len);
+    call->buf = malloc(cap);
+    if (!call->buf) {
+        fprintf(stderr, "Out of memory for compression buffer\n");
+        return -1;
+    }
+    uint64_t t0 = thread_cpu_us();
+    call->stats.wire_bytes = codec_compress(codec, payload, len, call->buf, cap);
+    call->stats.cpu_us = thread_cpu_us() - t0;
+    if (call->stats.wire_bytes == 0) {
+        release_call(call);
         return -1;
     }
+    req->payload.data = call->buf;
+    req->payload.len = call->stats.wire_bytes;
+    req->compression = codec->type;
+    req->compression_level = codec->level;
     return 0;
 }
 
-int main(int argc, char** argv) {
-    struct CmdArgs args = {0};
+void release_call(struct DumpCall* call) {
+    free(call->buf);
+    call->buf = NULL;
+}
+
+int shm_fits(const struct CmdArgs* args, size_t len) {
+    return args->shm && len <= args->shm->size;
+}
+
+int prepare_shm_request(const struct CmdArgs* args, const char* dump_path,
+                        const uint8_t* payload, size_t len, struct ShmCall* call) {
+    if (shm_ring_alloc(args->shm, len, &call->slot) < 0) {
+        return -1;
+    }
+    memcpy(shm_slot_data(args->shm, &call->slot), payload, len);
+
+    Dumptool__V1__ShmDumpRequest* req = &call->req;
+    dumptool__v1__shm_dump_request__init(req);
+    req->dump_path = (char*)dump_path;
+    req->format = args->format;
+    req->segment = args->shm->name;
+    req->offset = call->slot.offset;
+    req->length = len;
+    FILL_METADATA(req, call->entries, call->ptrs,
+                  dumptool__v1__shm_dump_request__metadata_entry__init, &args->metadata);
     return 0;
-}
\ No newline at end of file
+}
+
+void release_shm_call(const struct CmdArgs* args, struct ShmCall* call) {
+    shm_ring_release(args->shm, &call->slot);
+}
+
+static int send_shm_dump(grpc_c_client_t* client, const struct CmdArgs* args,
+                         const char* dump_path, uint8_t* payload, size_t len) {
+    struct ShmCall call;
+    if (prepare_shm_request(args, dump_path, payload, len, &call) < 0) {
+        return SEND_LOCAL_ERROR;
+    }
+
+    limiter_acquire(args->limiter, 0);
+    Dumptool__V1__DumpResponse* resp = NULL;
+    int status = dumptool__v1__dump_service__send_shm_dump(client, NULL, 0, &call.req,
+                                                           &resp, NULL, -1);
+    release_shm_call(args, &call);
+    if (status != GRPC_C_OK || resp == NULL) {
+        fprintf(stderr, "SendShmDump failed (status %d)\n", status);
+        return -1;
+    }
+
+    if (!args->quiet) {
+        printf("Response: %s (%s)\n", resp->success ? "OK" : "FAILED", resp->message);
+    } else if (!resp->success) {
+        fprintf(stderr, "SendShmDump %s: %s\n", dump_path, resp->message);
+    }
+    limiter_backoff(args->limiter, resp->retry_after_ms);
+    int ret = resp->success ? 0 : server_busy(resp) ? SEND_BUSY : SEND_REJECTED;
+    dumptool__v1__dump_response__free_unpacked(resp, NULL);
+    return ret;
+}
+
+static int send_dump_once(grpc_c_client_t* client, const struct CmdArgs* args,
+                          const char* dump_path, uint8_t* payload, size_t len) {
+    struct DumpCall call;
+    if (prepare_request(args, dump_path, payload, len, &call) < 0) {
+        return SEND_LOCAL_ERROR;
+    }
+
+    limiter_acquire(args->limiter, call.req.payload.len);
+    Dumptool__V1__DumpResponse* resp = NULL;
+    int status = dumptool__v1__dump_service__send_dump(client, NULL, 0, &call.req,
+                                                       &resp, NULL, -1);
+    release_call(&call);
+    if (status != GRPC_C_OK || resp == NULL) {
+        fprintf(stderr, "SendDump failed (status %d)\n", status);
+        return -1;
+    }
+
+    if (resp->compression_unsupported &&
+        call.req.compression != DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__NONE) {
+        dumptool__v1__dump_response__free_unpacked(resp, NULL);
+        codec_disable(&args->codec);
+        return send_dump_once(client, args, dump_path, payload, len);
+    }
+
+    if (!args->quiet) {
+        printf("Response: %s (%s)\n", resp->success ? "OK" : "FAILED", resp->message);
+        print_codec_stats(codec_active(&args->codec), &call.stats, resp->decode_cpu_us);
+    } else if (!resp->success) {
+        fprintf(stderr, "SendDump %s: %s\n", dump_path, resp->message);
+    }
+    limiter_backoff(args->limiter, resp->retry_after_ms);
+    int ret = resp->success ? 0 : server_busy(resp) ? SEND_BUSY : SEND_REJECTED;
+    dumptool__v1__dump_response__free_unpacked(resp, NULL);
+    return ret;
+}
+
+int send_dump(grpc_c_client_t* client, const struct CmdArgs* args,
+              const char* dump_path, uint8_t* payload, size_t len) {
+    /* 下一次 limiter_acquire 会等到服务端建议的时间之后 */
+    for (int attempt = 0;; attempt++) {
+        int ret = shm_fits(args, len) ? send_shm_dump(client, args, dump_path, payload, len)
+                                      : send_dump_once(client, args, dump_path, payload, len);
+        if (ret != SEND_BUSY) {
+            return ret;
+        }
+        if (attempt >= args->retries) {
+            fprintf(stderr, "Server busy, giving up on %s\n", dump_path);
+            return SEND_BUSY;
+        }
+    }
+}
+
+char* join_dump_path(const char* prefix, const char* filename) {
+    const char* base = strrchr(filename, '/');
+    base = base ? base + 1 : filename;
+    size_t plen = strlen(prefix);
+    while (plen > 0 && prefix[plen - 1] == '/') {
+        plen--;
+    }
+
+    size_t size = plen + strlen(base) + 2;
+    char* path = malloc(size);
+    if (path) {
+        snprintf(path, size, "%.*s/%s", (int)plen, prefix, base);
+    }
+    return path;
+}
+
+const struct CmdArgs* route_payload(const struct CmdArgs* args, const uint8_t* payload,
+                                    size_t len, struct RoutedArgs* out) {
+    /* 自动识别只针对 protobuf, JSON 等格式需用 -t 指定类型 */
+    if (args->payload_type == PAYLOAD_NONE ||
+        (args->payload_type == PAYLOAD_AUTO &&
+         args->format != DUMPTOOL__V1__DUMP_REQUEST__DATA_FORMAT__PROTOBUF)) {
+        return args;
+    }
+    inspect_payload(args->payload_type, payload, len, &out->fields);
+    if (out->fields.count == 0) {
+        return args;
+    }
+
+    out->args = *args;
+    struct Metadata* md = &out->args.metadata;
+    for (size_t i = 0; i < out->fields.count && md->count < MAX_METADATA; i++) {
+        size_t j = 0;
+        while (j < md->count && strcmp(md->keys[j], out->fields.keys[i]) != 0) {
+            j++;
+        }
+        if (j == md->count) {
+            md->keys[md->count] = (char*)out->fields.keys[i];
+            md->values[md->count] = out->fields.values[i];
+            md->count++;
+        }
+    }
+    return &out->args;
+}
+
+const struct CmdArgs* aggregate_payload(const struct CmdArgs* args, uint8_t** payload,
+                                        size_t* len, struct CmdArgs* out) {
+    if (!args->aggregate || args->format != DUMPTOOL__V1__DUMP_REQUEST__DATA_FORMAT__PROTOBUF) {
+        return args;
+    }
+    uint8_t* merged;
+    size_t merged_len;
+    struct AggregateStats stats;
+    if (aggregate_mem(*payload, *len, &merged, &merged_len, &stats) < 0) {
+        if (!args->quiet) {
+            fprintf(stderr, "Not a memory dump, sending as is\n");
+        }
+        return args;
+    }
+    if (!args->quiet) {
+        printf("Aggregated: %zu allocations (%zu freed) -> %zu stacks, %zu -> %zu bytes\n",
+               stats.allocs, stats.freed, stats.stacks, *len, merged_len);
+    }
+    if (merged_len >= *len) {
+        free(merged);
+        return args;
+    }
+
+    *out = *args;
+    out->heap_payload = 1;
+    struct Metadata* md = &out->metadata;
+    size_t i = 0;
+    while (i < md->count && strcmp(md->keys[i], "aggregated") != 0) {
+        i++;
+    }
+    if (i == md->count && md->count < MAX_METADATA) {
+        md->keys[md->count] = (char*)"aggregated";
+        md->values[md->count] = (char*)"mem";
+        md->count++;
+    }
+    *payload = merged;
+    *len = merged_len;
+    return out;
+}
+
+static int send_once(grpc_c_client_t* client, const struct CmdArgs* args, const char* filename,
+                     const char* dump_path, uint8_t* payload, size_t len) {
+    int ret;
+    if (args->dedup && probe_dump(client, args, dump_path, payload, len) == 1) {
+        if (!args->quiet) {
+            printf("Already stored: %s (dedup)\n", dump_path);
+        }
+        ret = SEND_DEDUP;
+    } else if (!shm_fits(args, len) && (args->stream || len > STREAM_THRESHOLD)) {
+        char upload_id[UPLOAD_ID_LEN + 1];
+        const char* id = args->upload_id;
+        if (!id && filename && make_upload_id(filename, dump_path, upload_id) == 0) {
+            id = upload_id;
+        }
+        if (id && args->nchannels > 1 && len > STRIPE_THRESHOLD) {
+            ret = stripe_upload(args, dump_path, id, payload, len);
+        } else {
+            ret = upload_dump(client, args, dump_path, id, payload, len);
+        }
+    } else {
+        ret = send_dump(client, args, dump_path, payload, len);
+    }
+    return ret;
+}
+
+int send_payload(grpc_c_client_t* client, const struct CmdArgs* args, const char* filename,
+                 const char* dump_path, uint8_t* payload, size_t len) {
+    if (!args->shards) {
+        return send_once(client, args, filename, dump_path, payload, len);
+    }
+    /* 只有连接或传输失败才摘除服务端并换下一个, 最多尝试一轮; 繁忙和本地错误直接返回 */
+    int ret = -1;
+    for (int i = 0; i < args->shards->count; i++) {
+        struct Shard* shard = shard_pick(args->shards, &args->metadata, dump_path);
+        if (!shard) {
+            break;
+        }
+        ret = send_once(shard->client, args, filename, dump_path, payload, len);
+        shard_report(args->shards, shard, ret != -1);
+        if (ret != -1) {
+            break;
+        }
+    }
+    return ret;
+}
+
+int send_file(grpc_c_client_t* client, const struct CmdArgs* args,
+              const char* filename, const char* dump_path) {
+    uint8_t* payload = NULL;
+    size_t len = 0;
+    if (load_payload(filename, &payload, &len) < 0) {
+        return -1;
+    }
+
+    uint8_t* raw = payload;
+    size_t raw_len = len;
+    struct CmdArgs merged_args;
+    args = aggregate_payload(args, &payload, &len, &merged_args);
+    /* 合并后的 payload 由 malloc 分配, 原映射可以立即释放 */
+    int merged = payload != raw;
+    if (merged) {
+        unload_payload(raw, raw_len);
+    }
+
+    struct RoutedArgs routed;
+    args = route_payload(args, payload, len, &routed);
+    if (args == &routed.args && !args->quiet) {
+        printf("Metadata:");
+        for (size_t i = 0; i < routed.fields.count; i++) {
+            printf(" %s=%s", routed.fields.keys[i], routed.fields.values[i]);
+        }
+        printf("\n");
+    }
+
+    int ret = send_payload(client, args, filename, dump_path, payload, len);
+    if ((ret == -1 || ret == SEND_BUSY) && args->queue &&
+        queue_append(args->queue, dump_path, args->format, &args->metadata, payload, len) == 0) {
+        if (!args->quiet) {
+            printf("Queued %s for retry (%zu bytes)\n", dump_path, len);
+        }
+        ret = SEND_QUEUED;
+    }
+    if (merged) {
+        free(payload);
+    } else {
+        unload_payload(payload, len);
+    }
+    return ret;
+}
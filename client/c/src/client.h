@@ -0,0 +1,250 @@
+#ifndef DUMPCLIENT_CLIENT_H
+#define DUMPCLIENT_CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "generated/dumptool.pb-c.h"
+#include "generated/dumptool.grpc-c.h"
+#include "codec.h"
+#include "limiter.h"
+#include "shm.h"
+#include "queue.h"
+#include "inspect.h"
+#include "shard.h"
+#include "session.h"
+
+#define DEFAULT_SERVER   "localhost:50051"
+#define MAX_MESSAGE_SIZE (4 * 1024 * 1024)  // gRPC 服务端默认接收上限
+/* 超过则分块上传; 留出 64KB 给路径, metadata 和压缩最坏情况下的膨胀, 编码后不超过接收上限 */
+#define STREAM_THRESHOLD (MAX_MESSAGE_SIZE - 64 * 1024)
+#define DEFAULT_CHUNK_SIZE (1024 * 1024)
+#define DEFAULT_INFLIGHT 8
+#define DEFAULT_RETRIES 3
+#define DEFAULT_BENCH_SIZE (64 * 1024)
+#define STRIPE_THRESHOLD (64 * 1024 * 1024)  // 启用 -j 时超过此大小才分条并行上传
+#define MAX_CHANNELS 64
+#define UPLOAD_ID_LEN 32
+#define DIGEST_LEN 32
+#define MAX_METADATA 16
+
+/* send_file 返回值: 服务端已有相同内容, 未发送 payload */
+#define SEND_DEDUP 1
+/* send_file 返回值: 服务端不可达, 已存入磁盘队列 */
+#define SEND_QUEUED 2
+/* 服务端收到请求但拒绝, 重发无意义, 不进入磁盘队列 */
+#define SEND_REJECTED -2
+/* 服务端持续繁忙, 重试次数用完; 稍后可重发, 但不摘除该服务端 */
+#define SEND_BUSY -3
+/* 本地错误 (压缩, 共享内存槽位, 内存不足等), 与服务端无关, 不摘除也不进入磁盘队列 */
+#define SEND_LOCAL_ERROR -4
+/* 其余 -1 表示连接或传输失败 */
+
+/* 服务端写入队列已满时不处理请求, 只给出 retry_after_ms, 稍后可重发 */
+static inline int server_busy(const Dumptool__V1__DumpResponse* resp) {
+    return !resp->success && resp->retry_after_ms > 0;
+}
+
+struct Metadata {
+    size_t count;
+    char* keys[MAX_METADATA];
+    char* values[MAX_METADATA];
+};
+
+/* protobuf-c 为每个 map 字段生成独立的 entry 类型, 按类型逐个填充 */
+#define FILL_METADATA(msg, entries, ptrs, init, md)          \
+    do {                                                     \
+        for (size_t i_ = 0; i_ < (md)->count; i_++) {        \
+            init(&(entries)[i_]);                            \
+            (entries)[i_].key = (md)->keys[i_];              \
+            (entries)[i_].value = (md)->values[i_];          \
+            (ptrs)[i_] = &(entries)[i_];                     \
+        }                                                    \
+        (msg)->n_metadata = (md)->count;                     \
+        (msg)->metadata = (ptrs);                            \
+    } while (0)
+
+struct CmdArgs {
+    char* server;
+    char* dump_path;
+    char* input_file;
+    char* batch;
+    char* spool;
+    char* archive;
+    size_t bench_count;
+    size_t bench_size;
+    char* upload_id;
+    Dumptool__V1__DumpRequest__DataFormat format;
+    int stream;
+    size_t chunk_size;
+    int inflight;
+    int retries;
+    int dedup;
+    struct Metadata metadata;
+    struct Codec codec;
+    struct Limiter* limiter;
+    int quiet;  // 嵌入使用时不向 stdout 输出逐请求日志
+    struct ShmRing* shm;  // 非空时经共享内存环提交, 仅用于 unix: 地址
+    grpc_c_client_t** channels;  // 分条上传用的独立连接, channels[0] 为主连接
+    int nchannels;
+    struct DiskQueue* queue;  // 非空时发送失败的 payload 存入磁盘队列稍后重发
+    int heap_payload;  // payload 在堆上而非文件映射, 读过的页不能丢弃
+    enum PayloadType payload_type;  // 从 payload 提取路由字段写入 metadata
+    int aggregate;  // 内存 dump 在本地合并后再发送
+    struct ShardSet* shards;  // 多个服务端时按分片键选择连接, 否则全部发往主连接
+    int session;  // 批量和压测模式下小 payload 经 DumpSession 流水发送
+};
+
+struct CodecStats {
+    size_t raw_bytes;
+    size_t wire_bytes;
+    uint64_t cpu_us;
+};
+
+/* 一次 SendDump 调用的请求及其附属缓冲区, 需存活到调用完成 */
+struct DumpCall {
+    Dumptool__V1__DumpRequest req;
+    Dumptool__V1__DumpRequest__MetadataEntry entries[MAX_METADATA];
+    Dumptool__V1__DumpRequest__MetadataEntry* ptrs[MAX_METADATA];
+    uint8_t* buf;
+    struct CodecStats stats;
+};
+
+int load_payload(const char* filename, uint8_t** buf, size_t* len);
+void unload_payload(uint8_t* buf, size_t len);
+
+/*
+ * 已发送或已读过的区间不会再访问, 从 RSS 中丢弃对应的整页.
+ * 只对文件映射有效, 匿名内存上 MADV_DONTNEED 会清零数据, 由 heap_payload 跳过.
+ */
+void release_pages(const struct CmdArgs* args, uint8_t* base, size_t offset, size_t len);
+
+/* 填充 SendDump 请求, 需要压缩时压缩到 call->buf, 完成后调用 release_call */
+int prepare_request(const struct CmdArgs* args, const char* dump_path,
+                    uint8_t* payload, size_t len, struct DumpCall* call);
+void release_call(struct DumpCall* call);
+
+/* 共享内存提交的请求, payload 已复制到 slot, 需存活到调用完成 */
+struct ShmCall {
+    Dumptool__V1__ShmDumpRequest req;
+    Dumptool__V1__ShmDumpRequest__MetadataEntry entries[MAX_METADATA];
+    Dumptool__V1__ShmDumpRequest__MetadataEntry* ptrs[MAX_METADATA];
+    struct ShmSlot slot;
+};
+
+/* payload 能否整体放入共享内存环 */
+int shm_fits(const struct CmdArgs* args, size_t len);
+
+/* 在环中分配空间并复制 payload, 完成后调用 release_shm_call */
+int prepare_shm_request(const struct CmdArgs* args, const char* dump_path,
+                        const uint8_t* payload, size_t len, struct ShmCall* call);
+void release_shm_call(const struct CmdArgs* args, struct ShmCall* call);
+
+/*
+ * 能放入共享内存环时走 SendShmDump, 否则走 SendDump; 服务端拒绝时返回 SEND_REJECTED.
+ * 服务端繁忙时按其建议暂停后重发, args->retries 次后仍繁忙返回 SEND_BUSY, 不摘除该服务端,
+ * 由调用方决定是否存入磁盘队列. 不可达时返回 -1.
+ */
+int send_dump(grpc_c_client_t* client, const struct CmdArgs* args,
+              const char* dump_path, uint8_t* payload, size_t len);
+
+/*
+ * 分块上传, upload_id 非空时可续传: 每次尝试前向服务端查询已提交的
+ * 字节数, 失败后按指数退避重试 args->retries 次, 只补传缺失的尾部.
+ */
+int upload_dump(grpc_c_client_t* client, const struct CmdArgs* args,
+                const char* dump_path, const char* upload_id,
+                uint8_t* payload, size_t len);
+
+/*
+ * 发送 payload 的 [offset, stripe_end) 部分. stripe_end 为 0 时发送到末尾并在
+ * 末块附带整体摘要; 否则作为条带发送, 不带摘要.
+ */
+int upload_range(grpc_c_client_t* client, const struct CmdArgs* args,
+                 const char* dump_path, const char* upload_id,
+                 uint8_t* payload, size_t len, size_t offset, size_t stripe_end);
+
+/*
+ * 把 payload 按 chunk 对齐切成 args->nchannels 个条带, 经各自的连接并行上传,
+ * 期间在本地计算整体摘要, 全部到齐后用 CommitUpload 提交. 条带各自可续传.
+ */
+int stripe_upload(const struct CmdArgs* args, const char* dump_path,
+                  const char* upload_id, uint8_t* payload, size_t len);
+
+/* 建立 n - 1 个不共享 TCP 连接的额外 channel, 与 primary 一起存入 args */
+int open_channels(struct CmdArgs* args, grpc_c_client_t* primary, int n);
+void close_channels(struct CmdArgs* args);
+
+/* 由主机名, dump_path 和文件身份(inode/大小/mtime)生成稳定的 upload_id */
+int make_upload_id(const char* filename, const char* dump_path,
+                   char id[UPLOAD_ID_LEN + 1]);
+
+/* 分段计算 payload 的 SHA-256, 读过的页面随即释放 */
+void payload_digest(const struct CmdArgs* args, uint8_t* payload, size_t len,
+                    uint8_t digest[DIGEST_LEN]);
+
+/*
+ * 计算 payload 的 SHA-256 并向服务端探测, 服务端已有相同内容时返回 1,
+ * 不存在或探测失败时返回 0.
+ */
+int probe_dump(grpc_c_client_t* client, const struct CmdArgs* args,
+               const char* dump_path, uint8_t* payload, size_t len);
+
+/* 附带了从 payload 提取的路由字段的参数副本, 需存活到请求发送完成 */
+struct RoutedArgs {
+    struct CmdArgs args;
+    struct PayloadFields fields;
+};
+
+/*
+ * 按 args->payload_type 扫描 payload, 把提取出的字段补入 metadata (不覆盖 -m 指定的键),
+ * 返回 &out->args; 未提取到字段时原样返回 args.
+ */
+const struct CmdArgs* route_payload(const struct CmdArgs* args, const uint8_t* payload,
+                                    size_t len, struct RoutedArgs* out);
+
+/*
+ * args->aggregate 时合并 Mem/ProcMem payload (见 aggregate.h). 合并后更小时 *payload, *len
+ * 换为新分配的缓冲区, 由调用方 free, 返回带 aggregated=mem 标记的参数副本 out;
+ * 否则原样返回 args.
+ */
+const struct CmdArgs* aggregate_payload(const struct CmdArgs* args, uint8_t** payload,
+                                        size_t* len, struct CmdArgs* out);
+
+/* PREFIX/basename(filename), 由调用方 free */
+char* join_dump_path(const char* prefix, const char* filename);
+
+/*
+ * 发送已加载的 payload: 按大小选择 SendDump, 分块或分条上传, 开启 -D 时先探测.
+ * 配置了 args->shards 时按分片键选择服务端, 连接失败则摘除该服务端并改发下一个.
+ * filename 用于生成续传的 upload_id, 可为 NULL.
+ */
+int send_payload(grpc_c_client_t* client, const struct CmdArgs* args, const char* filename,
+                 const char* dump_path, uint8_t* payload, size_t len);
+
+/*
+ * 加载文件并按大小选择 SendDump 或分块上传, 内容已存在时返回 SEND_DEDUP,
+ * 服务端不可达而存入 args->queue 时返回 SEND_QUEUED.
+ */
+int send_file(grpc_c_client_t* client, const struct CmdArgs* args,
+              const char* filename, const char* dump_path);
+
+void print_codec_stats(const struct Codec* codec, const struct CodecStats* stats,
+                       uint64_t server_cpu_us);
+
+/* 压缩时向各服务端查询可解压的算法, 有服务端不支持 args->codec 则整个进程改为不压缩 */
+void negotiate_codec(grpc_c_client_t* client, const struct CmdArgs* args);
+
+/* 批量上传目录或 glob 匹配的文件, 复用同一个 channel */
+int run_batch(grpc_c_client_t* client, const struct CmdArgs* args);
+
+/* 以 args->inflight 并发发送 bench_count 个合成 payload, 报告吞吐和延迟分位数 */
+int run_bench(grpc_c_client_t* client, const struct CmdArgs* args);
+
+/*
+ * 常驻监视 spool 目录, 文件写完关闭(或移入)后由工作线程上传,
+ * 成功后删除或移入 args->archive, 被服务端拒绝的移入 spool 下的 .rejected,
+ * 其余失败每隔一段时间重试; 收到 SIGINT/SIGTERM 时处理完队列后退出.
+ */
+int run_spool(grpc_c_client_t* client, const struct CmdArgs* args);
+
+#endif
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <pthread.h>
+#include <lz4frame.h>
+#include <zstd.h>
+#include "codec.h"
+
+#define DEFAULT_ZSTD_LEVEL 3
+
+/* 服务端不支持所选算法后进程内的发送都改为不压缩 */
+static int codec_disabled;
+static const struct Codec codec_none = { DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__NONE, 0 };
+
+/* ZSTD_CCtx 不能跨线程共享, 条带/spool/库的发送线程各用一个, 线程退出时释放 */
+static pthread_key_t cctx_key;
+static pthread_once_t cctx_once = PTHREAD_ONCE_INIT;
+
+static void free_cctx(void* cctx) {
+    ZSTD_freeCCtx(cctx);
+}
+
+static void make_cctx_key(void) {
+    pthread_key_create(&cctx_key, free_cctx);
+}
+
+static ZSTD_CCtx* thread_cctx(void) {
+    pthread_once(&cctx_once, make_cctx_key);
+    ZSTD_CCtx* cctx = pthread_getspecific(cctx_key);
+    if (!cctx) {
+        cctx = ZSTD_createCCtx();
+        pthread_setspecific(cctx_key, cctx);
+    }
+    return cctx;
+}
+
+int codec_parse(const char* spec, struct Codec* codec) {
+    memset(codec, 0, sizeof(*codec));
+
+    const char* colon = strchr(spec, ':');
+    size_t name_len = colon ? (size_t)(colon - spec) : strlen(spec);
+    if (name_len == 4 && strncasecmp(spec, "none", 4) == 0) {
+        codec->type = DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__NONE;
+    } else if (name_len == 3 && strncasecmp(spec, "lz4", 3) == 0) {
+        codec->type = DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__LZ4;
+    } else if (name_len == 4 && strncasecmp(spec, "zstd", 4) == 0) {
+        codec->type = DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__ZSTD;
+        codec->level = DEFAULT_ZSTD_LEVEL;
+    } else {
+        return -1;
+    }
+
+    if (colon) {
+        char* end = NULL;
+        codec->level = (int)strtol(colon + 1, &end, 10);
+        if (*end != '\0') {
+            return -1;
+        }
+    }
+
+    if (codec->type == DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__ZSTD &&
+        (codec->level < ZSTD_minCLevel() || codec->level > ZSTD_maxCLevel())) {
+        return -1;
+    }
+    return 0;
+}
+
+const char* codec_name(const struct Codec* codec) {
+    switch (codec->type) {
+    case DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__LZ4:
+        return "lz4";
+    case DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__ZSTD:
+        return "zstd";
+    default:
+        return "none";
+    }
+}
+
+void codec_disable(const struct Codec* codec) {
+    if (codec->type != DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__NONE &&
+        !__atomic_exchange_n(&codec_disabled, 1, __ATOMIC_RELAXED)) {
+        fprintf(stderr, "Server cannot decode %s, sending uncompressed\n", codec_name(codec));
+    }
+}
+
+const struct Codec* codec_active(const struct Codec* codec) {
+    return __atomic_load_n(&codec_disabled, __ATOMIC_RELAXED) ? &codec_none : codec;
+}
+
+size_t codec_bound(const struct Codec* codec, size_t len) {
+    switch (codec->type) {
+    case DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__LZ4: {
+        LZ4F_preferences_t prefs = LZ4F_INIT_PREFERENCES;
+        prefs.compressionLevel = codec->level;
+        return LZ4F_compressFrameBound(len, &prefs);
+    }
+    case DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__ZSTD:
+        return ZSTD_compressBound(len);
+    default:
+        return len;
+    }
+}
+
+size_t codec_compress(const struct Codec* codec, const uint8_t* src, size_t len,
+                      uint8_t* dst, size_t cap) {
+    size_t ret;
+    switch (codec->type) {
+    case DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__LZ4: {
+        LZ4F_preferences_t prefs = LZ4F_INIT_PREFERENCES;
+        prefs.compressionLevel = codec->level;
+        prefs.frameInfo.contentSize = len;
+        ret = LZ4F_compressFrame(dst, cap, src, len, &prefs);
+        if (LZ4F_isError(ret)) {
+            fprintf(stderr, "LZ4 compression failed: %s\n", LZ4F_getErrorName(ret));
+            return 0;
+        }
+        return ret;
+    }
+    case DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__ZSTD: {
+        ZSTD_CCtx* cctx = thread_cctx();
+        if (!cctx) {
+            fprintf(stderr, "zstd context allocation failed\n");
+            return 0;
+        }
+        ret = ZSTD_compressCCtx(cctx, dst, cap, src, len, codec->level);
+        if (ZSTD_isError(ret)) {
+            fprintf(stderr, "zstd compression failed: %s\n", ZSTD_getErrorName(ret));
+            return 0;
+        }
+        return ret;
+    }
+    default:
+        if (len > cap) {
+            return 0;
+        }
+        memcpy(dst, src, len);
+        return len;
+    }
+}
+
+void codec_free(struct Codec* codec) {
+    (void)codec;
+    /* 主线程不经 pthread_exit 退出, 其上下文需显式释放 */
+    if (pthread_once(&cctx_once, make_cctx_key) == 0) {
+        ZSTD_freeCCtx(pthread_getspecific(cctx_key));
+        pthread_setspecific(cctx_key, NULL);
+    }
+}
+
+uint64_t thread_cpu_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
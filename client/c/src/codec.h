@@ -0,0 +1,34 @@
+#ifndef DUMPCLIENT_CODEC_H
+#define DUMPCLIENT_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "generated/dumptool.pb-c.h"
+
+struct Codec {
+    Dumptool__V1__DumpRequest__Compression type;
+    int level;
+};
+
+/* 解析 "none" / "lz4[:LEVEL]" / "zstd[:LEVEL]" */
+int codec_parse(const char* spec, struct Codec* codec);
+const char* codec_name(const struct Codec* codec);
+
+/* 服务端不能解压 codec 时调用, 此后 codec_active 对所有 codec 都返回 none */
+void codec_disable(const struct Codec* codec);
+const struct Codec* codec_active(const struct Codec* codec);
+
+/* 压缩 len 字节所需的最大输出空间 */
+size_t codec_bound(const struct Codec* codec, size_t len);
+
+/* 一次性压缩为独立的帧, 返回压缩后长度, 失败返回 0 */
+size_t codec_compress(const struct Codec* codec, const uint8_t* src, size_t len,
+                      uint8_t* dst, size_t cap);
+
+/* 释放调用线程的压缩上下文, 其他线程的在线程退出时释放 */
+void codec_free(struct Codec* codec);
+
+/* 当前线程消耗的 CPU 时间(微秒) */
+uint64_t thread_cpu_us(void);
+
+#endif
@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include "client.h"
+#include "dumpclient.h"
+
+#define LIB_WORKERS 2
+#define LIB_MAX_QUEUE_BYTES (256UL * 1024 * 1024)
+
+struct Submission {
+    struct Submission* next;
+    char* dump_path;
+    Dumptool__V1__DumpRequest__DataFormat format;
+    struct Metadata metadata;
+    uint8_t* buf;
+    size_t len;
+    void (*free_fn)(void*);
+};
+
+struct dumpclient {
+    grpc_c_client_t* client;
+    struct CmdArgs args;
+    struct Limiter limiter;
+    struct ShmRing shm;
+    struct DiskQueue queue;
+    struct ShardSet shards;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t idle;
+    struct Submission* head;
+    struct Submission* tail;
+    size_t queued_bytes;  // 已提交但未发送完成的字节数, 含正在发送的
+    size_t max_queue_bytes;
+    int busy;
+    int closing;
+    int failed;
+    int workers;
+    pthread_t* threads;
+};
+
+/* grpc-c 为进程级全局状态, 多个实例共享一次初始化 */
+static pthread_mutex_t grpc_lock = PTHREAD_MUTEX_INITIALIZER;
+static int grpc_refs;
+
+static void grpc_ref(void) {
+    pthread_mutex_lock(&grpc_lock);
+    if (grpc_refs++ == 0) {
+        grpc_c_init(GRPC_THREADS, NULL);
+    }
+    pthread_mutex_unlock(&grpc_lock);
+}
+
+static void grpc_unref(void) {
+    pthread_mutex_lock(&grpc_lock);
+    if (--grpc_refs == 0) {
+        grpc_c_shutdown();
+    }
+    pthread_mutex_unlock(&grpc_lock);
+}
+
+static void free_submission(struct Submission* s) {
+    for (size_t i = 0; i < s->metadata.count; i++) {
+        free(s->metadata.keys[i]);
+        free(s->metadata.values[i]);
+    }
+    if (s->free_fn) {
+        s->free_fn(s->buf);
+    }
+    free(s->dump_path);
+    free(s);
+}
+
+static void* worker_main(void* arg) {
+    struct dumpclient* dc = arg;
+    for (;;) {
+        pthread_mutex_lock(&dc->lock);
+        while (!dc->head && !dc->closing) {
+            pthread_cond_wait(&dc->not_empty, &dc->lock);
+        }
+        struct Submission* s = dc->head;
+        if (!s) {
+            pthread_mutex_unlock(&dc->lock);
+            return NULL;
+        }
+        dc->head = s->next;
+        if (!dc->head) {
+            dc->tail = NULL;
+        }
+        dc->busy++;
+        pthread_mutex_unlock(&dc->lock);
+
+        struct CmdArgs args = dc->args;
+        args.format = s->format;
+        args.metadata = s->metadata;
+        uint8_t* payload = s->buf;
+        size_t len = s->len;
+        struct CmdArgs merged_args;
+        struct RoutedArgs routed;
+        const struct CmdArgs* a = aggregate_payload(&args, &payload, &len, &merged_args);
+        a = route_payload(a, payload, len, &routed);
+        int ret = send_payload(dc->client, a, NULL, s->dump_path, payload, len);
+        if ((ret == -1 || ret == SEND_BUSY) && a->queue) {
+            ret = queue_append(a->queue, s->dump_path, s->format, &a->metadata, payload, len);
+        }
+        if (payload != s->buf) {
+            free(payload);
+        }
+
+        pthread_mutex_lock(&dc->lock);
+        dc->busy--;
+        dc->queued_bytes -= s->len;
+        if (ret < 0) {
+            dc->failed++;
+        }
+        if (!dc->head && dc->busy == 0) {
+            pthread_cond_broadcast(&dc->idle);
+        }
+        pthread_mutex_unlock(&dc->lock);
+        free_submission(s);
+    }
+}
+
+struct dumpclient* dumpclient_init(const struct dumpclient_options* opts) {
+    struct dumpclient_options defaults = {0};
+    if (!opts) {
+        opts = &defaults;
+    }
+    struct dumpclient* dc = calloc(1, sizeof(*dc));
+    if (!dc) {
+        return NULL;
+    }
+    dc->args.server = (char*)(opts->server ? opts->server : DEFAULT_SERVER);
+    dc->args.chunk_size = DEFAULT_CHUNK_SIZE;
+    dc->args.retries = DEFAULT_RETRIES;
+    dc->args.quiet = 1;
+    dc->args.heap_payload = 1;
+    dc->args.aggregate = opts->aggregate_mem;
+    dc->args.limiter = &dc->limiter;
+    dc->workers = opts->workers > 0 ? opts->workers : LIB_WORKERS;
+    dc->max_queue_bytes = opts->max_queue_bytes ? opts->max_queue_bytes : LIB_MAX_QUEUE_BYTES;
+    if (opts->payload_type && payload_type_parse(opts->payload_type, &dc->args.payload_type) < 0) {
+        fprintf(stderr, "dumpclient: invalid payload type %s\n", opts->payload_type);
+        free(dc);
+        return NULL;
+    }
+    if (codec_parse(opts->codec ? opts->codec : "none", &dc->args.codec) < 0) {
+        fprintf(stderr, "dumpclient: invalid codec %s\n", opts->codec);
+        free(dc);
+        return NULL;
+    }
+    if (limiter_init(&dc->limiter, opts->bytes_per_sec, opts->requests_per_sec, NULL) < 0) {
+        codec_free(&dc->args.codec);
+        free(dc);
+        return NULL;
+    }
+    if (opts->queue_dir) {
+        if (queue_open(&dc->queue, opts->queue_dir, opts->queue_max_bytes) < 0) {
+            limiter_destroy(&dc->limiter);
+            codec_free(&dc->args.codec);
+            free(dc);
+            return NULL;
+        }
+        dc->args.queue = &dc->queue;
+    }
+    pthread_mutex_init(&dc->lock, NULL);
+    pthread_cond_init(&dc->not_empty, NULL);
+    pthread_cond_init(&dc->idle, NULL);
+    int sharded = strchr(dc->args.server, ',') != NULL;
+    if (opts->shm_ring_bytes && !sharded && strncmp(dc->args.server, "unix:", 5) == 0 &&
+        shm_ring_init(&dc->shm, opts->shm_ring_bytes) == 0) {
+        dc->args.shm = &dc->shm;
+    }
+
+    grpc_ref();
+    if (!sharded) {
+        dc->client = grpc_c_client_init(dc->args.server, "libdumpclient", NULL, NULL);
+    } else if (shard_init(&dc->shards, dc->args.server, opts->shard_keys, 1) == 0) {
+        dc->args.shards = &dc->shards;
+        dc->client = dc->shards.shards[0].client;
+    }
+    if (dc->client) {
+        negotiate_codec(dc->client, &dc->args);
+    }
+    dc->threads = calloc(dc->workers, sizeof(*dc->threads));
+    int started = 0;
+    while (dc->client && dc->threads && started < dc->workers &&
+           pthread_create(&dc->threads[started], NULL, worker_main, dc) == 0) {
+        started++;
+    }
+    if (started < dc->workers || (dc->args.shards && shard_start(&dc->shards) < 0) ||
+        (dc->args.queue && queue_start(&dc->queue, dc->client, &dc->args) < 0)) {
+        fprintf(stderr, "dumpclient: failed to start client for %s\n", dc->args.server);
+        dc->workers = started;
+        dumpclient_shutdown(dc);
+        return NULL;
+    }
+    return dc;
+}
+
+int dumpclient_submit(struct dumpclient* dc, const char* dump_path,
+                      enum dumpclient_format format, const char* const* metadata,
+                      void* buf, size_t len, void (*free_fn)(void*)) {
+    struct Submission* s = calloc(1, sizeof(*s));
+    if (!s) {
+        return -1;
+    }
+    s->dump_path = strdup(dump_path);
+    s->format = (Dumptool__V1__DumpRequest__DataFormat)format;
+    for (; metadata && metadata[0]; metadata += 2) {
+        if (!metadata[1] || s->metadata.count == MAX_METADATA) {
+            free_submission(s);
+            errno = EINVAL;
+            return -1;
+        }
+        s->metadata.keys[s->metadata.count] = strdup(metadata[0]);
+        s->metadata.values[s->metadata.count] = strdup(metadata[1]);
+        s->metadata.count++;
+    }
+    int nomem = !s->dump_path;
+    for (size_t i = 0; i < s->metadata.count; i++) {
+        nomem |= !s->metadata.keys[i] || !s->metadata.values[i];
+    }
+    if (nomem) {
+        free_submission(s);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    pthread_mutex_lock(&dc->lock);
+    int full = dc->queued_bytes + len > dc->max_queue_bytes && dc->queued_bytes > 0;
+    if (!full) {
+        dc->queued_bytes += len;
+    }
+    pthread_mutex_unlock(&dc->lock);
+    if (full) {
+        free_submission(s);
+        errno = EAGAIN;
+        return -1;
+    }
+
+    /* 在锁外复制, 不拖慢发送线程 */
+    if (free_fn) {
+        s->buf = buf;
+        s->free_fn = free_fn;
+    } else if (len > 0) {
+        s->buf = malloc(len);
+        s->free_fn = free;
+        if (s->buf) {
+            memcpy(s->buf, buf, len);
+        }
+    }
+    if (len > 0 && !s->buf) {
+        pthread_mutex_lock(&dc->lock);
+        dc->queued_bytes -= len;
+        pthread_mutex_unlock(&dc->lock);
+        free_submission(s);
+        errno = ENOMEM;
+        return -1;
+    }
+    s->len = len;
+
+    pthread_mutex_lock(&dc->lock);
+    if (dc->tail) {
+        dc->tail->next = s;
+    } else {
+        dc->head = s;
+    }
+    dc->tail = s;
+    pthread_cond_signal(&dc->not_empty);
+    pthread_mutex_unlock(&dc->lock);
+    return 0;
+}
+
+int dumpclient_flush(struct dumpclient* dc, int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    if (timeout_ms >= 0) {
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    int ret = 0;
+    pthread_mutex_lock(&dc->lock);
+    while ((dc->head || dc->busy > 0) && ret == 0) {
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&dc->idle, &dc->lock);
+        } else {
+            ret = pthread_cond_timedwait(&dc->idle, &dc->lock, &deadline);
+        }
+    }
+    int failed = dc->failed;
+    if (ret == 0) {
+        dc->failed = 0;
+    }
+    pthread_mutex_unlock(&dc->lock);
+    if (ret != 0) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return failed;
+}
+
+int dumpclient_queue_stats(struct dumpclient* dc, struct dumpclient_queue_stats* stats) {
+    if (!dc->args.queue) {
+        return -1;
+    }
+    struct QueueStats qs;
+    queue_stats(&dc->queue, &qs);
+    stats->pending_records = qs.records;
+    stats->pending_bytes = qs.bytes;
+    stats->dropped_records = qs.dropped_records;
+    stats->dropped_bytes = qs.dropped_bytes;
+    return 0;
+}
+
+void dumpclient_shutdown(struct dumpclient* dc) {
+    if (!dc) {
+        return;
+    }
+    pthread_mutex_lock(&dc->lock);
+    dc->closing = 1;
+    pthread_cond_broadcast(&dc->not_empty);
+    pthread_mutex_unlock(&dc->lock);
+    for (int i = 0; i < dc->workers; i++) {
+        pthread_join(dc->threads[i], NULL);
+    }
+    queue_stop(&dc->queue);
+
+    /* 没有发送线程时队列中可能有残留 */
+    while (dc->head) {
+        struct Submission* s = dc->head;
+        dc->head = s->next;
+        free_submission(s);
+    }
+    if (dc->args.shards) {
+        shard_destroy(&dc->shards);
+    } else if (dc->client) {
+        grpc_c_client_free(dc->client);
+    }
+    grpc_unref();
+    pthread_mutex_destroy(&dc->lock);
+    pthread_cond_destroy(&dc->not_empty);
+    pthread_cond_destroy(&dc->idle);
+    queue_close(&dc->queue);
+    limiter_destroy(&dc->limiter);
+    shm_ring_destroy(&dc->shm);
+    codec_free(&dc->args.codec);
+    free(dc->threads);
+    free(dc);
+}
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "inspect.h"
+#include "wire.h"
+
+#define MAX_VALUES 8       // 不同取值超过此数时只给出范围
+#define GUESS_ELEMENTS 8   // 自动识别时查看的元素个数
+
+/* 识别依据, 参见 converttool/flamegraph/mem_profile.proto, prototest/timeline/timeline.proto, test3/trace.proto */
+enum {
+    EV_TRACE = 1,      // Event.name/track/stack_frames, 或 varint 的 Event.ts
+    EV_TIMELINE = 2,   // Stage.comm, 或 varint 的 Stage.end_us
+    EV_MEM = 4,        // ProcMem 的 alloc/free 列表
+    EV_LEN2 = 8,       // ProcMem.mem_alloc_stacks 或 Event.cat
+    EV_VARINT34 = 16,  // Stage.rank/step_id 或 Event.pid/tid
+};
+
+struct Schema {
+    enum PayloadType type;
+    const char* name;
+    size_t nfields;
+    uint32_t numbers[2];
+    const char* keys[2];
+};
+
+static const struct Schema schemas[] = {
+    { PAYLOAD_MEM, "mem", 1, { 1 }, { "pid" } },
+    { PAYLOAD_TIMELINE, "timeline", 2, { 3, 4 }, { "rank", "step" } },
+    { PAYLOAD_TRACE, "trace", 1, { 3 }, { "pid" } },
+};
+
+struct ValueSet {
+    uint64_t values[MAX_VALUES];  // 升序
+    size_t count;
+    uint64_t min;
+    uint64_t max;
+    int overflow;
+};
+
+int payload_type_parse(const char* name, enum PayloadType* type) {
+    if (strcasecmp(name, "auto") == 0) {
+        *type = PAYLOAD_AUTO;
+        return 0;
+    }
+    if (strcasecmp(name, "none") == 0) {
+        *type = PAYLOAD_NONE;
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(schemas) / sizeof(schemas[0]); i++) {
+        if (strcasecmp(name, schemas[i].name) == 0) {
+            *type = schemas[i].type;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static const struct Schema* find_schema(enum PayloadType type) {
+    for (size_t i = 0; i < sizeof(schemas) / sizeof(schemas[0]); i++) {
+        if (schemas[i].type == type) {
+            return &schemas[i];
+        }
+    }
+    return NULL;
+}
+
+const char* payload_type_name(enum PayloadType type) {
+    const struct Schema* schema = find_schema(type);
+    if (schema) {
+        return schema->name;
+    }
+    return type == PAYLOAD_AUTO ? "auto" : "none";
+}
+
+static int field_evidence(const struct WireField* f) {
+    if (f->wire_type == WT_LEN) {
+        switch (f->number) {
+        case 1:
+        case 7:
+        case 9:
+            return EV_TRACE;
+        case 5:
+            return EV_TIMELINE;
+        case 3:
+        case 4:
+            return EV_MEM;
+        case 2:
+            return EV_LEN2;
+        }
+    } else if (f->wire_type == WT_VARINT) {
+        switch (f->number) {
+        case 5:
+            return EV_TRACE;
+        case 7:
+            return EV_TIMELINE;
+        case 3:
+        case 4:
+            return EV_VARINT34;
+        }
+    }
+    return 0;
+}
+
+static enum PayloadType guess_type(const uint8_t* p, size_t len) {
+    const uint8_t* end = p + len;
+    int evidence = 0;
+    size_t elements = 0;
+    struct WireField f;
+    while (p < end && elements < GUESS_ELEMENTS) {
+        if (wire_next_field(&p, end, &f) < 0) {
+            return PAYLOAD_NONE;
+        }
+        if (f.number != 1 || f.wire_type != WT_LEN) {
+            /* 只有 TraceData 还有其他顶层字段 */
+            if (f.wire_type != WT_LEN || (f.number != 2 && f.number != 3)) {
+                return PAYLOAD_NONE;
+            }
+            evidence |= EV_TRACE;
+            continue;
+        }
+        elements++;
+        const uint8_t* q = f.data;
+        struct WireField g;
+        while (q < f.data + f.len) {
+            if (wire_next_field(&q, f.data + f.len, &g) < 0) {
+                return PAYLOAD_NONE;
+            }
+            evidence |= field_evidence(&g);
+        }
+    }
+
+    switch (evidence & (EV_TRACE | EV_TIMELINE | EV_MEM)) {
+    case EV_TRACE:
+        return PAYLOAD_TRACE;
+    case EV_TIMELINE:
+        return PAYLOAD_TIMELINE;
+    case EV_MEM:
+        return evidence & EV_VARINT34 ? PAYLOAD_NONE : PAYLOAD_MEM;
+    case 0:
+        break;
+    default:
+        return PAYLOAD_NONE;
+    }
+    if ((evidence & EV_LEN2) && !(evidence & EV_VARINT34)) {
+        return PAYLOAD_MEM;
+    }
+    if ((evidence & EV_VARINT34) && !(evidence & EV_LEN2)) {
+        return PAYLOAD_TIMELINE;
+    }
+    return PAYLOAD_NONE;
+}
+
+static void add_value(struct ValueSet* set, uint64_t v) {
+    if (set->count == 0 && !set->overflow) {
+        set->min = set->max = v;
+    }
+    set->min = v < set->min ? v : set->min;
+    set->max = v > set->max ? v : set->max;
+    if (set->overflow) {
+        return;
+    }
+    size_t i = 0;
+    while (i < set->count && set->values[i] < v) {
+        i++;
+    }
+    if (i < set->count && set->values[i] == v) {
+        return;
+    }
+    if (set->count == MAX_VALUES) {
+        set->overflow = 1;
+        return;
+    }
+    memmove(&set->values[i + 1], &set->values[i], (set->count - i) * sizeof(v));
+    set->values[i] = v;
+    set->count++;
+}
+
+/* "3" / "1,4,7" / 取值过多时 "0-511" */
+static int format_values(const struct ValueSet* set, char* out, size_t cap) {
+    if (set->overflow) {
+        return snprintf(out, cap, "%llu-%llu", (unsigned long long)set->min,
+                        (unsigned long long)set->max);
+    }
+    size_t used = 0;
+    for (size_t i = 0; i < set->count; i++) {
+        int n = snprintf(out + used, cap - used, "%s%llu", i ? "," : "",
+                         (unsigned long long)set->values[i]);
+        if (n < 0 || (size_t)n >= cap - used) {
+            return -1;
+        }
+        used += (size_t)n;
+    }
+    return (int)used;
+}
+
+static void add_field(struct PayloadFields* fields, size_t* used, const char* key,
+                      const struct ValueSet* set, const char* literal) {
+    char* out = fields->text + *used;
+    size_t cap = sizeof(fields->text) - *used;
+    int n = literal ? snprintf(out, cap, "%s", literal) : format_values(set, out, cap);
+    if (n < 0 || (size_t)n >= cap || fields->count == INSPECT_MAX_FIELDS) {
+        return;
+    }
+    fields->keys[fields->count] = key;
+    fields->values[fields->count] = out;
+    fields->count++;
+    *used += (size_t)n + 1;
+}
+
+void inspect_payload(enum PayloadType type, const uint8_t* payload, size_t len,
+                     struct PayloadFields* fields) {
+    fields->type = PAYLOAD_NONE;
+    fields->count = 0;
+    if (type == PAYLOAD_NONE || !payload) {
+        return;
+    }
+    if (type == PAYLOAD_AUTO) {
+        type = guess_type(payload, len);
+    }
+    const struct Schema* schema = find_schema(type);
+    if (!schema) {
+        return;
+    }
+
+    struct ValueSet sets[2];
+    memset(sets, 0, sizeof(sets));
+    const uint8_t* p = payload;
+    const uint8_t* end = payload + len;
+    struct WireField f;
+    while (p < end) {
+        if (wire_next_field(&p, end, &f) < 0) {
+            return;
+        }
+        if (f.number != 1 || f.wire_type != WT_LEN) {
+            continue;
+        }
+        /* proto3 省略取值为 0 的字段, 缺省即为 0 */
+        uint64_t values[2] = { 0, 0 };
+        const uint8_t* q = f.data;
+        struct WireField g;
+        while (q < f.data + f.len) {
+            if (wire_next_field(&q, f.data + f.len, &g) < 0) {
+                return;
+            }
+            for (size_t i = 0; i < schema->nfields; i++) {
+                if (g.number == schema->numbers[i] && g.wire_type == WT_VARINT) {
+                    values[i] = g.value;
+                }
+            }
+        }
+        for (size_t i = 0; i < schema->nfields; i++) {
+            add_value(&sets[i], values[i]);
+        }
+    }
+
+    fields->type = type;
+    size_t used = 0;
+    add_field(fields, &used, "type", NULL, schema->name);
+    for (size_t i = 0; i < schema->nfields; i++) {
+        if (sets[i].count > 0) {
+            add_field(fields, &used, schema->keys[i], &sets[i], NULL);
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef DUMPCLIENT_INSPECT_H
+#define DUMPCLIENT_INSPECT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum PayloadType {
+    PAYLOAD_AUTO = 0,   // 仅对 protobuf 格式按字段布局识别
+    PAYLOAD_NONE,
+    PAYLOAD_MEM,        // Mem.proc_mem[].pid
+    PAYLOAD_TIMELINE,   // Timeline.stages[].rank / step_id
+    PAYLOAD_TRACE,      // TraceData.trace_events[].pid
+};
+
+#define INSPECT_MAX_FIELDS 3
+#define INSPECT_TEXT 256
+
+/* 提取出的路由字段, values 指向 text */
+struct PayloadFields {
+    enum PayloadType type;
+    size_t count;
+    const char* keys[INSPECT_MAX_FIELDS];
+    char* values[INSPECT_MAX_FIELDS];
+    char text[INSPECT_TEXT];
+};
+
+int payload_type_parse(const char* name, enum PayloadType* type);
+const char* payload_type_name(enum PayloadType type);
+
+/*
+ * 只遍历顶层 repeated 字段中每个元素的直接字段, 嵌套消息按长度跳过, 不做完整解析.
+ * type 为 PAYLOAD_AUTO 时由前几个元素的字段编号和 wire type 判断类型.
+ * 无法识别或编码不合法时 fields->count 为 0.
+ */
+void inspect_payload(enum PayloadType type, const uint8_t* payload, size_t len,
+                     struct PayloadFields* fields);
+
+#endif
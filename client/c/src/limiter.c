@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "limiter.h"
+
+#define CONTROL_CHECK_US 1000000
+
+static volatile sig_atomic_t reload_requested;
+
+static void on_sighup(int sig) {
+    (void)sig;
+    reload_requested = 1;
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int limiter_parse_rate(const char* spec, double* rate) {
+    char* end = NULL;
+    double value = strtod(spec, &end);
+    if (end == spec || value < 0) {
+        return -1;
+    }
+    switch (*end) {
+    case 'k': case 'K': value *= 1024; end++; break;
+    case 'm': case 'M': value *= 1024 * 1024; end++; break;
+    case 'g': case 'G': value *= 1024.0 * 1024 * 1024; end++; break;
+    }
+    if (*end != '\0' && *end != '\n') {
+        return -1;
+    }
+    *rate = value;
+    return 0;
+}
+
+/* 控制文件每行 "bytes_per_sec=RATE" 或 "requests_per_sec=RATE", 未出现的项保持不变 */
+static void load_control(struct Limiter* limiter) {
+    FILE* f = fopen(limiter->control_file, "r");
+    if (!f) {
+        return;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char* eq = strchr(line, '=');
+        double rate;
+        if (!eq || line[0] == '#' || limiter_parse_rate(eq + 1, &rate) < 0) {
+            continue;
+        }
+        *eq = '\0';
+        if (strcmp(line, "bytes_per_sec") == 0) {
+            limiter->bytes_per_sec = rate;
+        } else if (strcmp(line, "requests_per_sec") == 0) {
+            limiter->reqs_per_sec = rate;
+        }
+    }
+    fclose(f);
+    fprintf(stderr, "Rate limit: %.0f bytes/s, %.1f requests/s (0 = unlimited)\n",
+            limiter->bytes_per_sec, limiter->reqs_per_sec);
+}
+
+static void check_control(struct Limiter* limiter, uint64_t now) {
+    if (!limiter->control_file || (!reload_requested && now < limiter->next_check_us)) {
+        return;
+    }
+    limiter->next_check_us = now + CONTROL_CHECK_US;
+    struct stat st;
+    if (stat(limiter->control_file, &st) < 0) {
+        return;
+    }
+    if (reload_requested || st.st_mtime != limiter->control_mtime) {
+        reload_requested = 0;
+        limiter->control_mtime = st.st_mtime;
+        load_control(limiter);
+    }
+}
+
+int limiter_init(struct Limiter* limiter, double bytes_per_sec, double reqs_per_sec,
+                 const char* control_file) {
+    memset(limiter, 0, sizeof(*limiter));
+    limiter->bytes_per_sec = bytes_per_sec;
+    limiter->reqs_per_sec = reqs_per_sec;
+    limiter->control_file = control_file;
+    limiter->last_us = now_us();
+    if (pthread_mutex_init(&limiter->lock, NULL) != 0) {
+        return -1;
+    }
+    if (control_file) {
+        struct sigaction sa = {0};
+        sa.sa_handler = on_sighup;
+        sigaction(SIGHUP, &sa, NULL);
+        check_control(limiter, limiter->last_us);
+    }
+    limiter->byte_tokens = limiter->bytes_per_sec;
+    limiter->req_tokens = limiter->reqs_per_sec;
+    return 0;
+}
+
+void limiter_destroy(struct Limiter* limiter) {
+    pthread_mutex_destroy(&limiter->lock);
+}
+
+/* 补充令牌并预留 need, 返回需要等待的微秒数; 欠下的配额由后续请求偿还 */
+static uint64_t take(double* tokens, double rate, double need, double elapsed) {
+    if (rate <= 0) {
+        return 0;
+    }
+    *tokens += rate * elapsed;
+    if (*tokens > rate) {
+        *tokens = rate;
+    }
+    *tokens -= need;
+    return *tokens < 0 ? (uint64_t)(-*tokens / rate * 1e6) : 0;
+}
+
+void limiter_acquire(struct Limiter* limiter, size_t bytes) {
+    pthread_mutex_lock(&limiter->lock);
+    uint64_t now = now_us();
+    check_control(limiter, now);
+    double elapsed = (now - limiter->last_us) / 1e6;
+    limiter->last_us = now;
+
+    uint64_t wait = take(&limiter->byte_tokens, limiter->bytes_per_sec, (double)bytes, elapsed);
+    uint64_t req_wait = take(&limiter->req_tokens, limiter->reqs_per_sec, 1.0, elapsed);
+    if (req_wait > wait) {
+        wait = req_wait;
+    }
+    if (limiter->pause_until_us > now + wait) {
+        wait = limiter->pause_until_us - now;
+    }
+    pthread_mutex_unlock(&limiter->lock);
+
+    if (wait > 0) {
+        struct timespec ts = { (time_t)(wait / 1000000), (long)(wait % 1000000) * 1000 };
+        while (nanosleep(&ts, &ts) < 0) {
+        }
+    }
+}
+
+void limiter_backoff(struct Limiter* limiter, uint32_t ms) {
+    if (ms == 0) {
+        return;
+    }
+    pthread_mutex_lock(&limiter->lock);
+    uint64_t until = now_us() + (uint64_t)ms * 1000;
+    if (until > limiter->pause_until_us) {
+        limiter->pause_until_us = until;
+    }
+    pthread_mutex_unlock(&limiter->lock);
+}
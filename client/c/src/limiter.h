@@ -0,0 +1,39 @@
+#ifndef DUMPCLIENT_LIMITER_H
+#define DUMPCLIENT_LIMITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+/*
+ * 字节/请求两个令牌桶, 桶容量为一秒的配额, 速率为 0 表示不限.
+ * 速率可通过控制文件在运行时调整: 文件 mtime 变化或收到 SIGHUP 时重新读取.
+ */
+struct Limiter {
+    pthread_mutex_t lock;
+    double bytes_per_sec;
+    double reqs_per_sec;
+    double byte_tokens;
+    double req_tokens;
+    uint64_t last_us;
+    uint64_t pause_until_us;  // 服务端要求的退避截止时间
+    const char* control_file;
+    time_t control_mtime;
+    uint64_t next_check_us;
+};
+
+/* 解析 "512K" / "20M" / "1G" 等速率, 后缀按 1024 进位 */
+int limiter_parse_rate(const char* spec, double* rate);
+
+int limiter_init(struct Limiter* limiter, double bytes_per_sec, double reqs_per_sec,
+                 const char* control_file);
+void limiter_destroy(struct Limiter* limiter);
+
+/* 为一次请求预留 bytes 字节的配额, 配额不足或处于退避期时阻塞 */
+void limiter_acquire(struct Limiter* limiter, size_t bytes);
+
+/* 服务端报告队列压力时调用, ms 毫秒内不再发出新请求 */
+void limiter_backoff(struct Limiter* limiter, uint32_t ms);
+
+#endif
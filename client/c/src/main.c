@@ -0,0 +1,390 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <strings.h>
+#include <grpc/grpc.h>
+#include <grpc/support/log.h>
+#include "client.h"
+
+void print_usage(const char* prog_name) {
+    printf("Usage: %s -p PATH -i FILE [OPTIONS]\n", prog_name);
+    printf("       %s -p PREFIX -d DIR|GLOB [OPTIONS]\n", prog_name);
+    printf("       %s -p PREFIX -w SPOOL [-A ARCHIVE] [OPTIONS]\n", prog_name);
+    printf("       %s -p PREFIX -B COUNT [-z SIZE] [OPTIONS]\n", prog_name);
+    printf("       %s -Q DIR [OPTIONS]\n\n", prog_name);
+    printf("Options:\n");
+    printf("  -s ADDRESS  Server address, host:port or unix:PATH (default: %s);\n"
+           "              a comma-separated list shards dumps by consistent hash\n",
+           DEFAULT_SERVER);
+    printf("  -H KEYS     Metadata keys whose values pick the server when sharding\n"
+           "              (default: %s, falls back to the dump path)\n", DEFAULT_SHARD_KEYS);
+    printf("  -f FORMAT   Data format (json/protobuf/binary)\n");
+    printf("  -S          Upload in chunks over a stream (implied above %d KB)\n",
+           STREAM_THRESHOLD / 1024);
+    printf("  -k KB       Chunk size for streamed uploads (default: %d)\n",
+           DEFAULT_CHUNK_SIZE / 1024);
+    printf("  -j COUNT    Split streamed uploads above %d MB into COUNT stripes sent\n"
+           "              in parallel over separate connections (max %d)\n",
+           STRIPE_THRESHOLD / (1024 * 1024), MAX_CHANNELS);
+    printf("  -U ID       Upload ID for resuming a streamed upload (default: derived)\n");
+    printf("  -r COUNT    Retries for streamed uploads, resumed from the committed\n"
+           "              offset (default: %d)\n", DEFAULT_RETRIES);
+    printf("  -d DIR|GLOB Upload every file in DIR (or matching GLOB) under PREFIX\n");
+    printf("  -n COUNT    Max in-flight requests in batch/benchmark mode, or upload\n"
+           "              workers in spool mode (default: %d)\n", DEFAULT_INFLIGHT);
+    printf("  -w SPOOL    Run as a daemon, shipping each file closed in SPOOL\n");
+    printf("  -A DIR      Move shipped spool files into DIR instead of deleting them\n");
+    printf("  -B COUNT    Benchmark: send COUNT synthetic payloads with -n concurrency\n");
+    printf("  -z SIZE     Benchmark payload size with K/M suffix (default: %d K)\n",
+           DEFAULT_BENCH_SIZE / 1024);
+    printf("  -P          With -d or -B, pipeline payloads below %d KB over one\n"
+           "              DumpSession stream, acked in batches; the server's credits\n"
+           "              and -n cap the unacked ones (try -n 64)\n",
+           STREAM_THRESHOLD / 1024);
+    printf("  -m KEY=VAL  Attach metadata (repeatable, max %d)\n", MAX_METADATA);
+    printf("  -t TYPE     Extract routing metadata from the payload: auto (protobuf\n"
+           "              only), none, mem (pid), timeline (rank, step), trace (pid)\n");
+    printf("  -a          Merge protobuf memory dumps (Mem/ProcMem) locally before upload:\n"
+           "              drop freed allocations, sum identical stacks per stage\n");
+    printf("  -D          Probe the server by SHA-256 and skip payloads it already has\n");
+    printf("  -b RATE     Limit upload bandwidth, bytes/s with K/M/G suffix\n");
+    printf("  -q RATE     Limit requests (and stream chunks) per second\n");
+    printf("  -L FILE     Control file overriding -b/-q at runtime, re-read when it\n"
+           "              changes or on SIGHUP (bytes_per_sec=RATE, requests_per_sec=RATE)\n");
+    printf("  -M SIZE     With a unix: server, hand payloads over through a shared\n"
+           "              memory ring of SIZE (K/M/G) instead of the socket\n");
+    printf("  -Q DIR      Keep payloads the server could not be reached for in a disk\n"
+           "              queue under DIR and resend them in the background; without\n"
+           "              a mode, send the queue (retrying with backoff) and exit\n");
+    printf("  -C SIZE     Disk queue limit with K/M/G suffix, oldest entries are dropped\n"
+           "              beyond it (default: %lu M)\n", DEFAULT_QUEUE_BYTES / (1024 * 1024));
+    printf("  -c CODEC    Compress payload: none, lz4[:LEVEL], zstd[:LEVEL]\n");
+    printf("  -h          Show this help\n");
+}
+
+int parse_format(const char* name, Dumptool__V1__DumpRequest__DataFormat* format) {
+    if (strcasecmp(name, "json") == 0) {
+        *format = DUMPTOOL__V1__DUMP_REQUEST__DATA_FORMAT__JSON;
+    } else if (strcasecmp(name, "protobuf") == 0) {
+        *format = DUMPTOOL__V1__DUMP_REQUEST__DATA_FORMAT__PROTOBUF;
+    } else if (strcasecmp(name, "binary") == 0) {
+        *format = DUMPTOOL__V1__DUMP_REQUEST__DATA_FORMAT__BINARY;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct CmdArgs args = {0};
+    args.server = DEFAULT_SERVER;
+    args.chunk_size = DEFAULT_CHUNK_SIZE;
+    args.inflight = DEFAULT_INFLIGHT;
+    args.retries = DEFAULT_RETRIES;
+    args.bench_size = DEFAULT_BENCH_SIZE;
+    double bytes_per_sec = 0, reqs_per_sec = 0;
+    const char* control_file = NULL;
+    size_t shm_size = 0;
+    int channels = 1;
+    const char* queue_dir = NULL;
+    size_t queue_bytes = DEFAULT_QUEUE_BYTES;
+    const char* shard_keys = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:H:p:i:d:w:A:B:z:n:j:f:Sk:U:r:Pm:t:aDb:q:L:M:Q:C:c:h")) != -1) {
+        switch (opt) {
+        case 's':
+            args.server = optarg;
+            break;
+        case 'H':
+            shard_keys = optarg;
+            break;
+        case 'p':
+            args.dump_path = optarg;
+            break;
+        case 'i':
+            args.input_file = optarg;
+            break;
+        case 'd':
+            args.batch = optarg;
+            break;
+        case 'w':
+            args.spool = optarg;
+            break;
+        case 'A':
+            args.archive = optarg;
+            break;
+        case 'B':
+            args.bench_count = strtoul(optarg, NULL, 10);
+            if (args.bench_count == 0) {
+                fprintf(stderr, "Invalid benchmark count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'z': {
+            double size;
+            if (limiter_parse_rate(optarg, &size) < 0) {
+                fprintf(stderr, "Invalid payload size: %s\n", optarg);
+                return 1;
+            }
+            args.bench_size = (size_t)size;
+            break;
+        }
+        case 'n':
+            args.inflight = atoi(optarg);
+            if (args.inflight <= 0) {
+                fprintf(stderr, "Invalid in-flight count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'j':
+            channels = atoi(optarg);
+            if (channels <= 0 || channels > MAX_CHANNELS) {
+                fprintf(stderr, "Invalid channel count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'f':
+            if (parse_format(optarg, &args.format) < 0) {
+                fprintf(stderr, "Unknown format: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'S':
+            args.stream = 1;
+            break;
+        case 'k':
+            args.chunk_size = strtoul(optarg, NULL, 10) * 1024;
+            if (args.chunk_size == 0 || args.chunk_size >= STREAM_THRESHOLD) {
+                fprintf(stderr, "Invalid chunk size: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'U':
+            args.upload_id = optarg;
+            break;
+        case 'r':
+            args.retries = atoi(optarg);
+            if (args.retries < 0) {
+                fprintf(stderr, "Invalid retry count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'P':
+            args.session = 1;
+            break;
+        case 'm': {
+            char* eq = strchr(optarg, '=');
+            if (!eq || eq == optarg || args.metadata.count == MAX_METADATA) {
+                fprintf(stderr, "Invalid metadata: %s\n", optarg);
+                return 1;
+            }
+            *eq = '\0';
+            args.metadata.keys[args.metadata.count] = optarg;
+            args.metadata.values[args.metadata.count] = eq + 1;
+            args.metadata.count++;
+            break;
+        }
+        case 't':
+            if (payload_type_parse(optarg, &args.payload_type) < 0) {
+                fprintf(stderr, "Invalid payload type: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'a':
+            args.aggregate = 1;
+            break;
+        case 'D':
+            args.dedup = 1;
+            break;
+        case 'b':
+            if (limiter_parse_rate(optarg, &bytes_per_sec) < 0) {
+                fprintf(stderr, "Invalid bandwidth limit: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'q':
+            if (limiter_parse_rate(optarg, &reqs_per_sec) < 0) {
+                fprintf(stderr, "Invalid request rate limit: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'L':
+            control_file = optarg;
+            break;
+        case 'M': {
+            double size;
+            if (limiter_parse_rate(optarg, &size) < 0 || size < 1) {
+                fprintf(stderr, "Invalid shared memory size: %s\n", optarg);
+                return 1;
+            }
+            shm_size = (size_t)size;
+            break;
+        }
+        case 'Q':
+            queue_dir = optarg;
+            break;
+        case 'C': {
+            double size;
+            if (limiter_parse_rate(optarg, &size) < 0 || size < 1) {
+                fprintf(stderr, "Invalid queue size: %s\n", optarg);
+                return 1;
+            }
+            queue_bytes = (size_t)size;
+            break;
+        }
+        case 'c':
+            if (codec_parse(optarg, &args.codec) < 0) {
+                fprintf(stderr, "Invalid codec: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    int modes = !!args.input_file + !!args.batch + !!args.spool + !!args.bench_count;
+    int drain_only = modes == 0 && queue_dir;
+    if ((!args.dump_path || modes != 1) && !drain_only) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!args.input_file && args.upload_id) {
+        fprintf(stderr, "-U can only be used with -i\n");
+        return 1;
+    }
+    if (args.archive && !args.spool) {
+        fprintf(stderr, "-A can only be used with -w\n");
+        return 1;
+    }
+    if (args.aggregate && args.format != DUMPTOOL__V1__DUMP_REQUEST__DATA_FORMAT__PROTOBUF) {
+        fprintf(stderr, "-a requires -f protobuf\n");
+        return 1;
+    }
+    if (args.session && !args.batch && !args.bench_count) {
+        fprintf(stderr, "-P can only be used with -d or -B\n");
+        return 1;
+    }
+    if (queue_dir && args.bench_count) {
+        fprintf(stderr, "-Q cannot be used with -B\n");
+        return 1;
+    }
+    int sharded = strchr(args.server, ',') != NULL;
+    if (shard_keys && !sharded) {
+        fprintf(stderr, "-H needs a comma-separated server list\n");
+        return 1;
+    }
+    if (sharded && (args.bench_count || shm_size || channels > 1 || args.session)) {
+        fprintf(stderr, "-B, -M, -j and -P need a single server\n");
+        return 1;
+    }
+    if (shm_size && args.session) {
+        fprintf(stderr, "-P cannot be used with -M\n");
+        return 1;
+    }
+    if (shm_size && strncmp(args.server, "unix:", 5) != 0) {
+        fprintf(stderr, "-M requires a unix: server address\n");
+        return 1;
+    }
+
+    struct ShmRing shm = {0};
+    if (shm_size) {
+        if (shm_ring_init(&shm, shm_size) < 0) {
+            return 1;
+        }
+        args.shm = &shm;
+    }
+
+    struct Limiter limiter;
+    if (limiter_init(&limiter, bytes_per_sec, reqs_per_sec, control_file) < 0) {
+        shm_ring_destroy(&shm);
+        return 1;
+    }
+    args.limiter = &limiter;
+
+    struct DiskQueue queue = {0};
+    if (queue_dir) {
+        if (queue_open(&queue, queue_dir, queue_bytes) < 0) {
+            limiter_destroy(&limiter);
+            shm_ring_destroy(&shm);
+            return 1;
+        }
+        args.queue = &queue;
+    }
+
+    grpc_c_init(GRPC_THREADS, NULL);
+    grpc_c_client_t* client = NULL;
+    struct ShardSet shards = {0};
+    if (!sharded) {
+        client = grpc_c_client_init(args.server, "dumpclient", NULL, NULL);
+        if (!client) {
+            fprintf(stderr, "Failed to connect to %s\n", args.server);
+        }
+    } else if (shard_init(&shards, args.server, shard_keys, 0) == 0) {
+        if (shard_start(&shards) == 0) {
+            args.shards = &shards;
+            client = shards.shards[0].client;  // 不按分片发送的请求用第一个服务端
+        } else {
+            shard_destroy(&shards);
+        }
+    }
+    if (!client) {
+        grpc_c_shutdown();
+        queue_close(&queue);
+        limiter_destroy(&limiter);
+        shm_ring_destroy(&shm);
+        return 1;
+    }
+    negotiate_codec(client, &args);
+
+    int ret;
+    if (open_channels(&args, client, channels) < 0) {
+        ret = -1;
+    } else if (drain_only) {
+        ret = queue_flush(&queue, client, &args);
+    } else if (args.bench_count) {
+        ret = run_bench(client, &args);
+    } else if (args.spool) {
+        /* 常驻时由后台线程补发队列 */
+        if (args.queue) {
+            queue_start(&queue, client, &args);
+        }
+        ret = run_spool(client, &args);
+        queue_stop(&queue);
+    } else if (args.batch) {
+        ret = run_batch(client, &args);
+    } else {
+        ret = send_file(client, &args, args.input_file, args.dump_path);
+    }
+
+    /* 单次运行时服务端可达则顺带补发之前积压的记录 */
+    if (args.queue && (args.batch || args.input_file) && ret != SEND_QUEUED) {
+        queue_drain(&queue, client, &args);
+    }
+    if (args.queue) {
+        struct QueueStats stats;
+        queue_stats(&queue, &stats);
+        if (drain_only || stats.records > 0 || stats.dropped_records > 0) {
+            print_queue_stats(&queue);
+        }
+    }
+    close_channels(&args);
+    if (args.shards) {
+        print_shard_stats(&shards);
+        shard_destroy(&shards);
+    } else {
+        grpc_c_client_free(client);
+    }
+    grpc_c_shutdown();
+    codec_free(&args.codec);
+    queue_close(&queue);
+    limiter_destroy(&limiter);
+    shm_ring_destroy(&shm);
+    return ret < 0 ? 1 : 0;
+}
@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <openssl/evp.h>
+#include "client.h"
+
+#define HASH_STEP (4 * 1024 * 1024)
+
+void payload_digest(const struct CmdArgs* args, uint8_t* payload, size_t len,
+                    uint8_t digest[DIGEST_LEN]) {
+    EVP_MD_CTX* md = EVP_MD_CTX_new();
+    EVP_DigestInit_ex(md, EVP_sha256(), NULL);
+    for (size_t pos = 0; pos < len; pos += HASH_STEP) {
+        size_t n = len - pos < HASH_STEP ? len - pos : HASH_STEP;
+        EVP_DigestUpdate(md, payload + pos, n);
+        release_pages(args, payload, pos, n);
+    }
+    unsigned int digest_len = 0;
+    EVP_DigestFinal_ex(md, digest, &digest_len);
+    EVP_MD_CTX_free(md);
+}
+
+int probe_dump(grpc_c_client_t* client, const struct CmdArgs* args,
+               const char* dump_path, uint8_t* payload, size_t len) {
+    uint8_t digest[DIGEST_LEN];
+    payload_digest(args, payload, len, digest);
+
+    Dumptool__V1__ProbeRequest__MetadataEntry entries[MAX_METADATA];
+    Dumptool__V1__ProbeRequest__MetadataEntry* ptrs[MAX_METADATA];
+    Dumptool__V1__ProbeRequest req;
+    dumptool__v1__probe_request__init(&req);
+    req.dump_path = (char*)dump_path;
+    req.format = args->format;
+    req.digest.data = digest;
+    req.digest.len = DIGEST_LEN;
+    req.size = len;
+    FILL_METADATA(&req, entries, ptrs,
+                  dumptool__v1__probe_request__metadata_entry__init, &args->metadata);
+
+    limiter_acquire(args->limiter, 0);
+    Dumptool__V1__ProbeResponse* resp = NULL;
+    if (dumptool__v1__dump_service__probe_dump(client, NULL, 0, &req, &resp,
+                                               NULL, -1) != GRPC_C_OK || !resp) {
+        fprintf(stderr, "ProbeDump failed, sending payload\n");
+        return 0;
+    }
+    int present = resp->present;
+    dumptool__v1__probe_response__free_unpacked(resp, NULL);
+    return present;
+}
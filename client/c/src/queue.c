@@ -0,0 +1,667 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "client.h"
+
+#define SEGMENT_BYTES (64UL * 1024 * 1024)
+#define RECORD_MAGIC 0x31515444  // "DTQ1"
+#define MAX_BACKOFF_SEC 60
+#define POLL_SEC 5  // 其他进程追加的记录靠定期检查发现
+
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t format;
+    uint32_t path_len;  // 含结尾的 '\0'
+    uint32_t meta_len;  // key\0value\0...
+    uint64_t payload_len;
+};
+
+/* head 文件的内容, 未落盘时最多导致重发, 不会丢记录 */
+struct QueueState {
+    uint64_t seq;
+    uint64_t off;
+    uint64_t dropped_records;
+    uint64_t dropped_bytes;
+};
+
+/* 映射到内存的一条记录, 各字段指向映射区 */
+struct QueueItem {
+    uint8_t* map;
+    size_t map_len;
+    uint64_t seq;
+    uint64_t off;
+    size_t rec_len;
+    char* dump_path;
+    Dumptool__V1__DumpRequest__DataFormat format;
+    struct Metadata metadata;
+    uint8_t* payload;
+    size_t len;
+};
+
+static volatile sig_atomic_t interrupted;
+
+static void on_signal(int sig) {
+    (void)sig;
+    interrupted = 1;
+}
+
+static void segment_path(const struct DiskQueue* q, uint64_t seq, char* path) {
+    snprintf(path, PATH_MAX, "%s/%016llu.log", q->dir, (unsigned long long)seq);
+}
+
+static off_t segment_size(const struct DiskQueue* q, uint64_t seq) {
+    char path[PATH_MAX];
+    struct stat st;
+    segment_path(q, seq, path);
+    return stat(path, &st) == 0 ? st.st_size : -1;
+}
+
+/* 段序号连续, 只需找出首尾; 没有段时返回 -1 */
+static int segment_range(const struct DiskQueue* q, uint64_t* first, uint64_t* last) {
+    DIR* dir = opendir(q->dir);
+    if (!dir) {
+        return -1;
+    }
+    int found = 0;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        char* end;
+        uint64_t seq = strtoull(ent->d_name, &end, 10);
+        if (end == ent->d_name || strcmp(end, ".log") != 0) {
+            continue;
+        }
+        if (!found || seq < *first) {
+            *first = seq;
+        }
+        if (!found || seq > *last) {
+            *last = seq;
+        }
+        found = 1;
+    }
+    closedir(dir);
+    return found ? 0 : -1;
+}
+
+static void sync_dir(const struct DiskQueue* q) {
+    int fd = open(q->dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+static void load_state(const struct DiskQueue* q, struct QueueState* st) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/head", q->dir);
+    memset(st, 0, sizeof(*st));
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return;
+    }
+    unsigned long long v[4];
+    if (fscanf(f, "%llu %llu %llu %llu", &v[0], &v[1], &v[2], &v[3]) == 4) {
+        st->seq = v[0];
+        st->off = v[1];
+        st->dropped_records = v[2];
+        st->dropped_bytes = v[3];
+    }
+    fclose(f);
+}
+
+static void save_state(const struct DiskQueue* q, const struct QueueState* st) {
+    char path[PATH_MAX], tmp[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/head", q->dir);
+    snprintf(tmp, sizeof(tmp), "%s/head.tmp", q->dir);
+    FILE* f = fopen(tmp, "w");
+    if (!f) {
+        perror("Queue head update failed");
+        return;
+    }
+    fprintf(f, "%llu %llu %llu %llu\n", (unsigned long long)st->seq,
+            (unsigned long long)st->off, (unsigned long long)st->dropped_records,
+            (unsigned long long)st->dropped_bytes);
+    if (fclose(f) != 0 || rename(tmp, path) < 0) {
+        perror("Queue head update failed");
+    }
+}
+
+/* 读位置与最后一个段, 读位置早于现存最旧的段时移到其开头; 没有段时返回 -1 */
+static int queue_position(const struct DiskQueue* q, struct QueueState* st, uint64_t* last) {
+    load_state(q, st);
+    uint64_t first;
+    if (segment_range(q, &first, last) < 0) {
+        return -1;
+    }
+    if (st->seq < first) {
+        st->seq = first;
+        st->off = 0;
+    }
+    return 0;
+}
+
+/* off 处完整记录的长度, 记录不完整或已损坏时返回 0 */
+static size_t read_record(int fd, uint64_t off, off_t size, struct RecordHeader* hdr) {
+    if (pread(fd, hdr, sizeof(*hdr), off) != (ssize_t)sizeof(*hdr) ||
+        hdr->magic != RECORD_MAGIC || hdr->path_len == 0 ||
+        hdr->payload_len > (uint64_t)size) {
+        return 0;
+    }
+    uint64_t len = sizeof(*hdr) + (uint64_t)hdr->path_len + hdr->meta_len + hdr->payload_len;
+    return off + len <= (uint64_t)size ? len : 0;
+}
+
+/*
+ * 把读位置移到下一条完整记录并返回其长度, 读完的段随即删除.
+ * 非末段中无法解析的部分整段跳过; 末段到头时队列为空, 返回 0.
+ */
+static size_t next_record(const struct DiskQueue* q, struct QueueState* st, uint64_t last,
+                          struct RecordHeader* hdr) {
+    for (;;) {
+        char path[PATH_MAX];
+        segment_path(q, st->seq, path);
+        size_t len = 0;
+        off_t size = -1;
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            struct stat sb;
+            if (fstat(fd, &sb) == 0) {
+                size = sb.st_size;
+                len = read_record(fd, st->off, size, hdr);
+            }
+            close(fd);
+        }
+        if (len > 0) {
+            return len;
+        }
+        if (st->seq >= last) {
+            return 0;
+        }
+        if (size > (off_t)st->off) {
+            fprintf(stderr, "Queue segment %s is corrupted at offset %llu, skipping the rest\n",
+                    path, (unsigned long long)st->off);
+        }
+        if (fd >= 0) {
+            unlink(path);
+        }
+        st->seq++;
+        st->off = 0;
+    }
+}
+
+static uint64_t pending_bytes(const struct DiskQueue* q, const struct QueueState* st,
+                              uint64_t last) {
+    uint64_t total = 0;
+    for (uint64_t seq = st->seq; seq <= last; seq++) {
+        off_t size = segment_size(q, seq);
+        if (size > 0) {
+            total += size;
+        }
+    }
+    return total > st->off ? total - st->off : 0;
+}
+
+/* 其他进程追加到一半崩溃时末段尾部留有残缺记录, 追加前截掉 */
+static off_t repair_tail(const struct DiskQueue* q, uint64_t seq, uint64_t from) {
+    char path[PATH_MAX];
+    segment_path(q, seq, path);
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) < 0) {
+        close(fd);
+        return 0;
+    }
+    struct RecordHeader hdr;
+    size_t n;
+    while ((n = read_record(fd, from, sb.st_size, &hdr)) > 0) {
+        from += n;
+    }
+    if ((off_t)from < sb.st_size) {
+        fprintf(stderr, "Queue segment %s has an incomplete record at offset %llu, "
+                "truncating\n", path, (unsigned long long)from);
+        if (ftruncate(fd, from) < 0) {
+            perror("Queue truncate failed");
+        }
+    }
+    close(fd);
+    return (off_t)from;
+}
+
+static void lock_queue(struct DiskQueue* q) {
+    pthread_mutex_lock(&q->lock);
+    flock(q->lock_fd, LOCK_EX);
+}
+
+static void unlock_queue(struct DiskQueue* q) {
+    flock(q->lock_fd, LOCK_UN);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static int write_all(int fd, const void* buf, size_t len) {
+    const uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int queue_open(struct DiskQueue* q, const char* dir, size_t max_bytes) {
+    memset(q, 0, sizeof(*q));
+    q->lock_fd = q->drain_fd = -1;
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        fprintf(stderr, "Cannot create queue %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/lock", dir);
+    q->lock_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    q->dir = strdup(dir);
+    if (q->lock_fd < 0 || !q->dir) {
+        fprintf(stderr, "Cannot open queue %s: %s\n", dir, strerror(errno));
+        if (q->lock_fd >= 0) {
+            close(q->lock_fd);
+        }
+        free(q->dir);
+        q->dir = NULL;
+        return -1;
+    }
+    q->max_bytes = max_bytes ? max_bytes : DEFAULT_QUEUE_BYTES;
+    q->tail_seq = UINT64_MAX;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->wake, NULL);
+    return 0;
+}
+
+void queue_close(struct DiskQueue* q) {
+    if (!q->dir) {
+        return;
+    }
+    queue_stop(q);
+    if (q->drain_fd >= 0) {
+        close(q->drain_fd);
+    }
+    close(q->lock_fd);
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->wake);
+    free(q->dir);
+    q->dir = NULL;
+}
+
+int queue_append(struct DiskQueue* q, const char* dump_path,
+                 Dumptool__V1__DumpRequest__DataFormat format,
+                 const struct Metadata* metadata, const uint8_t* payload, size_t len) {
+    size_t meta_len = 0;
+    for (size_t i = 0; i < metadata->count; i++) {
+        meta_len += strlen(metadata->keys[i]) + strlen(metadata->values[i]) + 2;
+    }
+    char* meta = malloc(meta_len + 1);
+    if (!meta) {
+        return -1;
+    }
+    char* p = meta;
+    for (size_t i = 0; i < metadata->count; i++) {
+        p = stpcpy(p, metadata->keys[i]) + 1;
+        p = stpcpy(p, metadata->values[i]) + 1;
+    }
+
+    struct RecordHeader hdr = { RECORD_MAGIC, (uint32_t)format, (uint32_t)strlen(dump_path) + 1,
+                                (uint32_t)meta_len, len };
+    uint64_t rec_len = sizeof(hdr) + hdr.path_len + meta_len + len;
+    if (rec_len > q->max_bytes) {
+        fprintf(stderr, "%s: %zu bytes exceed the queue limit\n", dump_path, len);
+        free(meta);
+        return -1;
+    }
+
+    lock_queue(q);
+    struct QueueState st;
+    uint64_t last;
+    if (queue_position(q, &st, &last) < 0) {
+        last = st.seq;
+    }
+    struct QueueState before = st;
+
+    off_t tail_size = segment_size(q, last);
+    if (tail_size < 0) {
+        tail_size = 0;
+    } else if (q->tail_seq != last || q->tail_end != (uint64_t)tail_size) {
+        uint64_t from = last == st.seq ? st.off : 0;
+        if (q->tail_seq == last && q->tail_end <= (uint64_t)tail_size && q->tail_end > from) {
+            from = q->tail_end;
+        }
+        tail_size = repair_tail(q, last, from);
+    }
+    if ((uint64_t)tail_size >= SEGMENT_BYTES) {
+        last++;
+        tail_size = 0;
+    }
+
+    /* 超出容量时丢弃最旧的记录 */
+    struct RecordHeader old;
+    size_t n;
+    while (pending_bytes(q, &st, last) + rec_len > q->max_bytes &&
+           (n = next_record(q, &st, last, &old)) > 0) {
+        st.off += n;
+        st.dropped_records++;
+        st.dropped_bytes += old.payload_len;
+    }
+
+    char path[PATH_MAX];
+    segment_path(q, last, path);
+    int ret = -1;
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open queue segment %s: %s\n", path, strerror(errno));
+    } else {
+        if (write_all(fd, &hdr, sizeof(hdr)) == 0 &&
+            write_all(fd, dump_path, hdr.path_len) == 0 &&
+            write_all(fd, meta, meta_len) == 0 &&
+            write_all(fd, payload, len) == 0 && fdatasync(fd) == 0) {
+            ret = 0;
+        } else {
+            fprintf(stderr, "Queue append to %s failed: %s\n", path, strerror(errno));
+            if (ftruncate(fd, tail_size) < 0) {
+                perror("Queue truncate failed");
+            }
+        }
+        close(fd);
+    }
+    if (ret == 0) {
+        if (tail_size == 0) {
+            sync_dir(q);
+        }
+        q->tail_seq = last;
+        q->tail_end = tail_size + rec_len;
+        pthread_cond_broadcast(&q->wake);
+    }
+    if (memcmp(&st, &before, sizeof(st)) != 0) {
+        save_state(q, &st);
+    }
+    unlock_queue(q);
+    free(meta);
+    return ret;
+}
+
+/* 映射一条记录, 失败返回 -1, 内容无法解析返回 1 */
+static int map_record(const struct DiskQueue* q, const struct QueueState* st, size_t len,
+                      const struct RecordHeader* hdr, struct QueueItem* item) {
+    char path[PATH_MAX];
+    segment_path(q, st->seq, path);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t start = st->off & ~(page - 1);
+    item->map_len = st->off + len - start;
+    void* map = mmap(NULL, item->map_len, PROT_READ, MAP_PRIVATE, fd, (off_t)start);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Queue mmap failed");
+        return -1;
+    }
+    item->map = map;
+    item->seq = st->seq;
+    item->off = st->off;
+    item->rec_len = len;
+    item->format = (Dumptool__V1__DumpRequest__DataFormat)hdr->format;
+
+    char* p = (char*)map + (st->off - start) + sizeof(*hdr);
+    item->dump_path = p;
+    int ok = p[hdr->path_len - 1] == '\0';
+    p += hdr->path_len;
+    char* meta_end = p + hdr->meta_len;
+    ok = ok && (hdr->meta_len == 0 || meta_end[-1] == '\0');
+    item->metadata.count = 0;
+    while (ok && p < meta_end) {
+        char* key = p;
+        p += strlen(p) + 1;
+        if (p >= meta_end || item->metadata.count == MAX_METADATA) {
+            ok = 0;
+            break;
+        }
+        item->metadata.keys[item->metadata.count] = key;
+        item->metadata.values[item->metadata.count] = p;
+        item->metadata.count++;
+        p += strlen(p) + 1;
+    }
+    item->payload = (uint8_t*)meta_end;
+    item->len = hdr->payload_len;
+    if (!ok) {
+        fprintf(stderr, "Queue record at %s:%llu is corrupted, dropping\n", path,
+                (unsigned long long)st->off);
+        munmap(item->map, item->map_len);
+        return 1;
+    }
+    return 0;
+}
+
+/* 映射读位置处的记录, 有记录返回 1, 队列为空返回 0 */
+static int peek_record(struct DiskQueue* q, struct QueueItem* item) {
+    lock_queue(q);
+    struct QueueState st;
+    uint64_t last;
+    int ret = 0;
+    if (queue_position(q, &st, &last) == 0) {
+        struct QueueState before = st;
+        struct RecordHeader hdr;
+        size_t len;
+        while ((len = next_record(q, &st, last, &hdr)) > 0) {
+            int mapped = map_record(q, &st, len, &hdr, item);
+            if (mapped <= 0) {
+                ret = mapped == 0 ? 1 : -1;
+                break;
+            }
+            st.off += len;
+            st.dropped_records++;
+            st.dropped_bytes += hdr.payload_len;
+        }
+        if (memcmp(&st, &before, sizeof(st)) != 0) {
+            save_state(q, &st);
+        }
+    }
+    unlock_queue(q);
+    return ret;
+}
+
+/* 记录已发送或被拒绝, 读位置后移; 期间已因容量上限被丢弃时不再移动 */
+static void pop_record(struct DiskQueue* q, struct QueueItem* item, int rejected) {
+    lock_queue(q);
+    struct QueueState st;
+    uint64_t last;
+    if (queue_position(q, &st, &last) == 0 && st.seq == item->seq && st.off == item->off) {
+        st.off += item->rec_len;
+        if (rejected) {
+            st.dropped_records++;
+            st.dropped_bytes += item->len;
+        }
+        save_state(q, &st);
+    }
+    unlock_queue(q);
+    munmap(item->map, item->map_len);
+}
+
+void queue_stats(struct DiskQueue* q, struct QueueStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    lock_queue(q);
+    struct QueueState st;
+    uint64_t last;
+    if (queue_position(q, &st, &last) == 0) {
+        for (uint64_t seq = st.seq; seq <= last; seq++) {
+            char path[PATH_MAX];
+            segment_path(q, seq, path);
+            int fd = open(path, O_RDONLY | O_CLOEXEC);
+            struct stat sb;
+            if (fd < 0) {
+                continue;
+            }
+            uint64_t pos = seq == st.seq ? st.off : 0;
+            struct RecordHeader hdr;
+            size_t n;
+            while (fstat(fd, &sb) == 0 && (n = read_record(fd, pos, sb.st_size, &hdr)) > 0) {
+                stats->records++;
+                stats->bytes += hdr.payload_len;
+                pos += n;
+            }
+            close(fd);
+        }
+    }
+    stats->dropped_records = st.dropped_records;
+    stats->dropped_bytes = st.dropped_bytes;
+    unlock_queue(q);
+}
+
+void print_queue_stats(struct DiskQueue* q) {
+    struct QueueStats stats;
+    queue_stats(q, &stats);
+    printf("Queue %s: %zu pending (%.2f MB), %zu dropped (%.2f MB)\n", q->dir,
+           stats.records, stats.bytes / 1e6, stats.dropped_records, stats.dropped_bytes / 1e6);
+}
+
+static int should_stop(struct DiskQueue* q) {
+    pthread_mutex_lock(&q->lock);
+    int stop = q->stopping;
+    pthread_mutex_unlock(&q->lock);
+    return stop || interrupted;
+}
+
+int queue_drain(struct DiskQueue* q, grpc_c_client_t* client, const struct CmdArgs* args) {
+    if (q->drain_fd < 0) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/drain.lock", q->dir);
+        int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0 || flock(fd, LOCK_EX | LOCK_NB) < 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return 1;
+        }
+        q->drain_fd = fd;
+    }
+
+    struct CmdArgs sub = *args;
+    sub.quiet = 1;
+    sub.upload_id = NULL;
+    size_t sent = 0;
+    int ret;
+    for (;;) {
+        if (should_stop(q)) {
+            ret = -1;
+            break;
+        }
+        struct QueueItem item;
+        ret = peek_record(q, &item);
+        if (ret <= 0) {
+            break;
+        }
+        sub.format = item.format;
+        sub.metadata = item.metadata;
+        int sent_ret = send_payload(client, &sub, NULL, item.dump_path, item.payload, item.len);
+        if (sent_ret == -1 || sent_ret == SEND_BUSY || sent_ret == SEND_LOCAL_ERROR) {
+            munmap(item.map, item.map_len);
+            ret = -1;
+            break;
+        }
+        if (sent_ret == SEND_REJECTED) {
+            fprintf(stderr, "Queue: %s rejected by the server, dropping\n", item.dump_path);
+        } else {
+            sent++;
+        }
+        pop_record(q, &item, sent_ret == SEND_REJECTED);
+    }
+    if (sent > 0 && !args->quiet) {
+        printf("Queue: sent %zu queued dumps\n", sent);
+    }
+    return ret;
+}
+
+int queue_flush(struct DiskQueue* q, grpc_c_client_t* client, const struct CmdArgs* args) {
+    struct sigaction sa = {0};
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    unsigned int backoff = 1;
+    int ret;
+    while ((ret = queue_drain(q, client, args)) < 0 && !interrupted) {
+        fprintf(stderr, "Queue: server unavailable, retrying in %u s\n", backoff);
+        for (unsigned int i = 0; i < backoff && !interrupted; i++) {
+            sleep(1);
+        }
+        backoff = backoff * 2 > MAX_BACKOFF_SEC ? MAX_BACKOFF_SEC : backoff * 2;
+    }
+    if (ret == 1) {
+        fprintf(stderr, "Queue %s is being sent by another process\n", q->dir);
+    }
+    return ret == 0 ? 0 : -1;
+}
+
+static void* drain_main(void* arg) {
+    struct DiskQueue* q = arg;
+    unsigned int backoff = 1;
+    pthread_mutex_lock(&q->lock);
+    while (!q->stopping) {
+        pthread_mutex_unlock(&q->lock);
+        int ret = queue_drain(q, q->client, q->args);
+        pthread_mutex_lock(&q->lock);
+
+        /* 退避期间的追加不提前唤醒, 否则服务端不可用时会变成忙等 */
+        unsigned int wait = ret < 0 ? backoff : POLL_SEC;
+        backoff = ret < 0 ? (backoff * 2 > MAX_BACKOFF_SEC ? MAX_BACKOFF_SEC : backoff * 2) : 1;
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += wait;
+        while (!q->stopping) {
+            int timed_out = pthread_cond_timedwait(&q->wake, &q->lock, &deadline) == ETIMEDOUT;
+            if (timed_out || ret >= 0) {
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
+
+int queue_start(struct DiskQueue* q, grpc_c_client_t* client, const struct CmdArgs* args) {
+    q->client = client;
+    q->args = args;
+    if (pthread_create(&q->thread, NULL, drain_main, q) != 0) {
+        fprintf(stderr, "Failed to start queue sender\n");
+        return -1;
+    }
+    q->running = 1;
+    return 0;
+}
+
+void queue_stop(struct DiskQueue* q) {
+    if (!q->running) {
+        return;
+    }
+    pthread_mutex_lock(&q->lock);
+    q->stopping = 1;
+    pthread_cond_broadcast(&q->wake);
+    pthread_mutex_unlock(&q->lock);
+    pthread_join(q->thread, NULL);
+    q->running = 0;
+    q->stopping = 0;
+}
@@ -0,0 +1,68 @@
+#ifndef DUMPCLIENT_QUEUE_H
+#define DUMPCLIENT_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "generated/dumptool.pb-c.h"
+#include "generated/dumptool.grpc-c.h"
+
+#define DEFAULT_QUEUE_BYTES (1024UL * 1024 * 1024)
+
+struct CmdArgs;
+struct Metadata;
+
+/*
+ * 服务端不可达时暂存 payload 的磁盘队列. 目录下是按序号命名的追加日志段,
+ * 读位置和丢弃计数记在 head 文件中; 总量超过 max_bytes 时从最旧的记录丢弃.
+ * 多个进程可共用同一目录: 追加和读位置的更新由 lock 文件上的 flock 串行化,
+ * 持有 drain.lock 的进程负责发送.
+ */
+struct DiskQueue {
+    char* dir;
+    size_t max_bytes;
+    int lock_fd;
+    int drain_fd;        // 取得发送权后持有 drain.lock
+    uint64_t tail_seq;   // 本进程上次追加到的位置, 与文件大小不符时先检查尾部
+    uint64_t tail_end;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t thread;
+    grpc_c_client_t* client;
+    const struct CmdArgs* args;
+    int running;
+    int stopping;
+};
+
+struct QueueStats {
+    size_t records;
+    size_t bytes;            // 待发送的 payload 字节数
+    size_t dropped_records;  // 因容量上限或被服务端拒绝而丢弃
+    size_t dropped_bytes;
+};
+
+int queue_open(struct DiskQueue* q, const char* dir, size_t max_bytes);
+void queue_close(struct DiskQueue* q);
+
+/* 追加一条记录并落盘, 空间不足时先丢弃最旧的记录 */
+int queue_append(struct DiskQueue* q, const char* dump_path,
+                 Dumptool__V1__DumpRequest__DataFormat format,
+                 const struct Metadata* metadata, const uint8_t* payload, size_t len);
+
+void queue_stats(struct DiskQueue* q, struct QueueStats* stats);
+void print_queue_stats(struct DiskQueue* q);
+
+/*
+ * 按入队顺序发送, 队列发空返回 0, 发送失败返回 -1,
+ * 其他进程正在发送时返回 1.
+ */
+int queue_drain(struct DiskQueue* q, grpc_c_client_t* client, const struct CmdArgs* args);
+
+/* 在当前线程发送, 失败后按指数退避重试, 直到队列为空或收到 SIGINT/SIGTERM */
+int queue_flush(struct DiskQueue* q, grpc_c_client_t* client, const struct CmdArgs* args);
+
+/* 后台线程: 有新记录时发送, 失败后按指数退避重试 */
+int queue_start(struct DiskQueue* q, grpc_c_client_t* client, const struct CmdArgs* args);
+void queue_stop(struct DiskQueue* q);
+
+#endif
@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "reader.h"
+
+#define SUBMIT_BATCH 8  // 攒够这么多读请求才进入内核提交一次
+
+static int uring_setup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, min_complete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned opcode, void* arg, unsigned nr) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr);
+}
+
+static int ring_init(struct FileReader* r, unsigned depth) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = uring_setup(depth, &p);
+    if (fd < 0) {
+        return -1;
+    }
+
+    r->sq_map_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_map_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    int single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) {
+        r->sq_map_len = r->cq_map_len = r->sq_map_len > r->cq_map_len ? r->sq_map_len
+                                                                      : r->cq_map_len;
+    }
+    r->sq_map = mmap(NULL, r->sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_SQ_RING);
+    r->cq_map = single || r->sq_map == MAP_FAILED
+                    ? r->sq_map
+                    : mmap(NULL, r->cq_map_len, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = r->cq_map == MAP_FAILED
+                  ? MAP_FAILED
+                  : mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        if (r->cq_map != MAP_FAILED && r->cq_map != r->sq_map) {
+            munmap(r->cq_map, r->cq_map_len);
+        }
+        if (r->sq_map != MAP_FAILED) {
+            munmap(r->sq_map, r->sq_map_len);
+        }
+        close(fd);
+        return -1;
+    }
+
+    uint8_t* sq = r->sq_map;
+    uint8_t* cq = r->cq_map;
+    r->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned*)(sq + p.sq_off.array);
+    r->cq_head = (unsigned*)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    r->ring_fd = fd;
+
+    /* 注册缓冲区省去每次读取时的页面固定; 受 RLIMIT_MEMLOCK 限制, 失败时仍可用普通读 */
+    struct iovec iov = { r->pool, r->pool_len };
+    r->fixed = uring_register(fd, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+    return 0;
+}
+
+int reader_init(struct FileReader* r, unsigned depth, unsigned nbufs, size_t buf_size) {
+    memset(r, 0, sizeof(*r));
+    r->ring_fd = -1;
+    r->buf_size = buf_size;
+    r->pool_len = (size_t)nbufs * buf_size;
+    r->pool = mmap(NULL, r->pool_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                   -1, 0);
+    r->bufs = calloc(nbufs, sizeof(*r->bufs));
+    if (r->pool == MAP_FAILED || !r->bufs) {
+        fprintf(stderr, "Out of memory for read buffers\n");
+        if (r->pool != MAP_FAILED) {
+            munmap(r->pool, r->pool_len);
+        }
+        free(r->bufs);
+        return -1;
+    }
+    for (unsigned i = 0; i < nbufs; i++) {
+        r->bufs[i].data = r->pool + (size_t)i * buf_size;
+        r->bufs[i].next = i + 1 < nbufs ? &r->bufs[i + 1] : NULL;
+    }
+    r->free_list = &r->bufs[0];
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->released, NULL);
+
+    if (ring_init(r, depth) < 0) {
+        fprintf(stderr, "io_uring unavailable (%s), using blocking reads\n", strerror(errno));
+    }
+    return 0;
+}
+
+void reader_destroy(struct FileReader* r) {
+    if (r->ring_fd >= 0) {
+        munmap(r->sqes, r->sqes_len);
+        if (r->cq_map != r->sq_map) {
+            munmap(r->cq_map, r->cq_map_len);
+        }
+        munmap(r->sq_map, r->sq_map_len);
+        close(r->ring_fd);
+    }
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->released);
+    munmap(r->pool, r->pool_len);
+    free(r->bufs);
+}
+
+static void push_ready(struct FileReader* r, struct ReadBuf* buf) {
+    buf->next = NULL;
+    if (r->ready_tail) {
+        r->ready_tail->next = buf;
+    } else {
+        r->ready = buf;
+    }
+    r->ready_tail = buf;
+    r->inflight++;
+}
+
+/* 从 buf->len 处读到 buf->size; io_uring 读不满时也由此补齐. 文件提前结束视为 EIO */
+static void read_sync(struct ReadBuf* buf) {
+    while (buf->len < buf->size) {
+        ssize_t n = pread(buf->fd, buf->data + buf->len, buf->size - buf->len, (off_t)buf->len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            buf->err = n < 0 ? errno : EIO;
+            break;
+        }
+        buf->len += (size_t)n;
+    }
+    close(buf->fd);
+}
+
+static int flush_pending(struct FileReader* r, unsigned min_complete) {
+    for (;;) {
+        unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+        int ret = uring_enter(r->ring_fd, r->pending, min_complete, flags);
+        if (ret >= 0) {
+            r->pending -= (unsigned)ret < r->pending ? (unsigned)ret : r->pending;
+            if (r->pending == 0 || min_complete) {
+                return 0;
+            }
+        } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            perror("io_uring_enter failed");
+            return -1;
+        }
+    }
+}
+
+void reader_submit(struct FileReader* r, const char* filename, size_t size, void* tag) {
+    pthread_mutex_lock(&r->lock);
+    while (!r->free_list) {
+        pthread_cond_wait(&r->released, &r->lock);
+    }
+    struct ReadBuf* buf = r->free_list;
+    r->free_list = buf->next;
+    pthread_mutex_unlock(&r->lock);
+
+    buf->tag = tag;
+    buf->len = 0;
+    buf->err = 0;
+    buf->fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (size > r->buf_size) {
+        size = r->buf_size;
+    }
+    buf->size = size;
+    if (buf->fd < 0 || r->ring_fd < 0) {
+        if (buf->fd < 0) {
+            buf->err = errno;
+        } else {
+            read_sync(buf);
+        }
+        push_ready(r, buf);
+        return;
+    }
+
+    unsigned tail = *r->sq_tail;
+    unsigned idx = tail & *r->sq_mask;
+    struct io_uring_sqe* sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = buf->fd;
+    sqe->user_data = (uint64_t)(uintptr_t)buf;
+    if (r->fixed) {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->addr = (uint64_t)(uintptr_t)buf->data;
+        sqe->len = (uint32_t)size;
+        sqe->buf_index = 0;
+    } else {
+        buf->iov.iov_base = buf->data;
+        buf->iov.iov_len = size;
+        sqe->opcode = IORING_OP_READV;
+        sqe->addr = (uint64_t)(uintptr_t)&buf->iov;
+        sqe->len = 1;
+    }
+    r->sq_array[idx] = idx;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->pending++;
+    r->inflight++;
+    if (r->pending >= SUBMIT_BATCH) {
+        flush_pending(r, 0);
+    }
+}
+
+struct ReadBuf* reader_next(struct FileReader* r, int wait) {
+    if (r->ready) {
+        struct ReadBuf* buf = r->ready;
+        r->ready = buf->next;
+        if (!r->ready) {
+            r->ready_tail = NULL;
+        }
+        r->inflight--;
+        return buf;
+    }
+    while (r->ring_fd >= 0 && r->inflight > 0) {
+        unsigned head = *r->cq_head;
+        if (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe* cqe = &r->cqes[head & *r->cq_mask];
+            struct ReadBuf* buf = (struct ReadBuf*)(uintptr_t)cqe->user_data;
+            int res = cqe->res;
+            __atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+            if (res < 0) {
+                buf->err = -res;
+                close(buf->fd);
+            } else {
+                /* 短读时同步读完剩余部分, 不把截断的内容当作完整文件 */
+                buf->len = (size_t)res;
+                read_sync(buf);
+            }
+            r->inflight--;
+            return buf;
+        }
+        if (!wait || flush_pending(r, 1) < 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+void reader_release(struct FileReader* r, struct ReadBuf* buf) {
+    pthread_mutex_lock(&r->lock);
+    buf->next = r->free_list;
+    r->free_list = buf;
+    pthread_cond_signal(&r->released);
+    pthread_mutex_unlock(&r->lock);
+}
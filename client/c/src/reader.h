@@ -0,0 +1,66 @@
+#ifndef DUMPCLIENT_READER_H
+#define DUMPCLIENT_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+struct ReadBuf {
+    uint8_t* data;
+    size_t len;      // 实际读到的字节数
+    size_t size;     // 请求读取的字节数, 读不满时 err 为 EIO
+    int err;         // 打开或读取失败时为 errno
+    int fd;
+    void* tag;
+    struct iovec iov;
+    struct ReadBuf* next;
+};
+
+/*
+ * 批量读取小文件: 文件由调用线程打开, 读请求经 io_uring 批量提交, 多个同时在途,
+ * 读入预先注册的缓冲区. 内核不支持 io_uring (或被禁用) 时退化为同步 read,
+ * 接口不变. submit/next 只能在同一线程调用, release 可在任意线程调用.
+ */
+struct FileReader {
+    int ring_fd;       // -1 表示同步 read
+    int fixed;         // 缓冲区已注册, 使用 READ_FIXED
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void* sq_map;
+    size_t sq_map_len;
+    void* cq_map;
+    size_t cq_map_len;
+    size_t sqes_len;
+    unsigned pending;   // 已填入 SQ, 尚未提交给内核
+    unsigned inflight;  // 已提交但尚未由 reader_next 取走
+    uint8_t* pool;
+    size_t pool_len;
+    size_t buf_size;
+    struct ReadBuf* bufs;
+    struct ReadBuf* ready;  // 打开失败或同步读完的缓冲区
+    struct ReadBuf* ready_tail;
+    pthread_mutex_t lock;
+    pthread_cond_t released;
+    struct ReadBuf* free_list;
+};
+
+/* depth 个读请求同时在途, 共 nbufs 个 buf_size 字节的缓冲区 */
+int reader_init(struct FileReader* r, unsigned depth, unsigned nbufs, size_t buf_size);
+void reader_destroy(struct FileReader* r);
+
+/* 打开 filename 并读取前 size (<= buf_size) 字节, 没有空闲缓冲区时等待 release */
+void reader_submit(struct FileReader* r, const char* filename, size_t size, void* tag);
+
+/* 取出一个已完成的读取; 没有在途读取, 或 wait 为 0 且暂无完成的, 返回 NULL */
+struct ReadBuf* reader_next(struct FileReader* r, int wait);
+
+void reader_release(struct FileReader* r, struct ReadBuf* buf);
+
+#endif
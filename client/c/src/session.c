@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "client.h"
+#include "session.h"
+
+/* 会话中断: 未确认的 dump 全部按未应答交还 */
+static void session_fail(struct Session* s) {
+    if (!s->broken && !s->args->quiet) {
+        fprintf(stderr, "DumpSession broken after %lu acked dumps\n", (unsigned long)s->acked);
+    }
+    s->broken = 1;
+    while (s->acked + 1 < s->next_seq) {
+        s->acked++;
+        s->done(s->tags[s->acked % s->window], 0, 0, NULL);
+    }
+}
+
+static int read_ack(struct Session* s) {
+    Dumptool__V1__SessionAck* ack = NULL;
+    if (s->ctx->gcc_stream->read(s->ctx, (void**)&ack, 0, -1) != GRPC_C_OK || !ack) {
+        session_fail(s);
+        return -1;
+    }
+    if (ack->acked > s->acked) {
+        s->acks++;
+    }
+    if (ack->credit > s->credit) {
+        s->credit = ack->credit;
+    }
+    limiter_backoff(s->args->limiter, ack->retry_after_ms);
+
+    /* failures 按 seq 升序 */
+    size_t f = 0;
+    uint64_t acked = ack->acked < s->next_seq ? ack->acked : s->next_seq - 1;
+    while (s->acked < acked) {
+        uint64_t seq = ++s->acked;
+        while (f < ack->n_failures && ack->failures[f]->seq < seq) {
+            f++;
+        }
+        int ok = f >= ack->n_failures || ack->failures[f]->seq != seq;
+        s->done(s->tags[seq % s->window], 1, ok, ok ? NULL : ack->failures[f]->message);
+    }
+    dumptool__v1__session_ack__free_unpacked(ack, NULL);
+    return 0;
+}
+
+int session_open(struct Session* s, grpc_c_client_t* client, const struct CmdArgs* args,
+                 session_done_fn done) {
+    memset(s, 0, sizeof(*s));
+    s->args = args;
+    s->done = done;
+    s->next_seq = 1;
+    s->window = (size_t)args->inflight;
+    s->tags = calloc(s->window, sizeof(*s->tags));
+    if (!s->tags) {
+        return -1;
+    }
+    if (dumptool__v1__dump_service__dump_session(client, NULL, 0, &s->ctx) != GRPC_C_OK ||
+        !s->ctx) {
+        free(s->tags);
+        return -1;
+    }
+    s->broken = 1;  // 初始额度到达前不报告中断
+    if (read_ack(s) < 0 || s->credit == 0) {
+        grpc_c_status_t status;
+        s->ctx->gcc_stream->finish(s->ctx, &status, 0);
+        free(s->tags);
+        return -1;
+    }
+    s->broken = 0;
+    return 0;
+}
+
+int session_send(struct Session* s, Dumptool__V1__DumpRequest* req, void* tag) {
+    while (!s->broken &&
+           (s->next_seq > s->credit || s->next_seq - s->acked > s->window)) {
+        read_ack(s);
+    }
+    if (s->broken) {
+        s->done(tag, 0, 0, NULL);
+        return -1;
+    }
+
+    Dumptool__V1__SessionDump msg;
+    dumptool__v1__session_dump__init(&msg);
+    msg.seq = s->next_seq;
+    msg.dump = req;
+    s->tags[msg.seq % s->window] = tag;
+    s->next_seq++;
+    limiter_acquire(s->args->limiter, req->payload.len);
+    if (s->ctx->gcc_stream->write(s->ctx, &msg, 0, -1) != GRPC_C_OK) {
+        session_fail(s);
+        return -1;
+    }
+    return 0;
+}
+
+void print_session_stats(const struct Session* s) {
+    unsigned long dumps = (unsigned long)(s->next_seq - 1);
+    printf("Session: %lu dumps in %zu acks (%.1f per ack)\n", dumps, s->acks,
+           s->acks ? (double)dumps / s->acks : 0.0);
+}
+
+int session_close(struct Session* s) {
+    if (!s->broken) {
+        s->ctx->gcc_stream->write_done(s->ctx, 0, -1);
+    }
+    while (!s->broken && s->acked + 1 < s->next_seq) {
+        read_ack(s);
+    }
+    grpc_c_status_t status;
+    s->ctx->gcc_stream->finish(s->ctx, &status, 0);
+    free(s->tags);
+    s->tags = NULL;
+    return s->broken ? -1 : 0;
+}
@@ -0,0 +1,50 @@
+#ifndef DUMPCLIENT_SESSION_H
+#define DUMPCLIENT_SESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "generated/dumptool.pb-c.h"
+#include "generated/dumptool.grpc-c.h"
+
+struct CmdArgs;
+
+/*
+ * 一个 dump 的结果. answered 为 0 表示会话中断前服务端未确认, 可能未处理;
+ * 服务端处理失败时 message 为其给出的原因.
+ */
+typedef void (*session_done_fn)(void* tag, int answered, int ok, const char* message);
+
+/*
+ * DumpSession 流上的发送端: dump 连续写出而不逐个等待应答, 未确认的数目达到服务端
+ * 授予的额度或 args->inflight 时才读取确认. 只能在一个线程中使用, 回调也在
+ * session_send / session_close 中执行.
+ */
+struct Session {
+    grpc_c_context_t* ctx;
+    const struct CmdArgs* args;
+    session_done_fn done;
+    void** tags;  // 未确认的 dump, 按 seq % window 存放
+    size_t window;
+    uint64_t next_seq;
+    uint64_t acked;
+    uint64_t credit;
+    size_t acks;  // 确认了新 dump 的应答数, 与 dump 数之比反映确认的批量程度
+    int broken;
+};
+
+/* 建立会话并等待服务端授予初始额度, 服务端不支持时返回 -1 */
+int session_open(struct Session* s, grpc_c_client_t* client, const struct CmdArgs* args,
+                 session_done_fn done);
+
+/*
+ * 写出 req, 额度用尽时先读取确认. req 只需存活到返回; tag 在确认后交给回调,
+ * 会话已中断时立即以 answered = 0 回调并返回 -1.
+ */
+int session_send(struct Session* s, Dumptool__V1__DumpRequest* req, void* tag);
+
+/* 结束发送并等待剩余的确认, 会话中途断开时返回 -1 */
+int session_close(struct Session* s);
+
+void print_session_stats(const struct Session* s);
+
+#endif
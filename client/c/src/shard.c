@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "client.h"
+
+#define CHECK_TIMEOUT_MS 2000
+#define MAX_CHECK_SEC 30
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static uint64_t fnv1a(uint64_t h, const void* data, size_t len) {
+    const uint8_t* p = data;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+/* FNV 的低位分布较差, 混合后再上环 */
+static uint64_t finish_hash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static int point_cmp(const void* a, const void* b) {
+    const struct RingPoint* x = a;
+    const struct RingPoint* y = b;
+    return x->hash < y->hash ? -1 : x->hash > y->hash;
+}
+
+/* 按逗号切分 buf, 跳过空项 */
+static int split_list(char* buf, char*** items) {
+    int n = 1;
+    for (const char* p = buf; *p; p++) {
+        n += *p == ',';
+    }
+    *items = calloc((size_t)n, sizeof(char*));
+    if (!*items) {
+        return -1;
+    }
+    int count = 0;
+    for (char* save = NULL, *tok = strtok_r(buf, ",", &save); tok;
+         tok = strtok_r(NULL, ",", &save)) {
+        (*items)[count++] = tok;
+    }
+    return count;
+}
+
+int shard_init(struct ShardSet* set, const char* servers, const char* keys, int quiet) {
+    memset(set, 0, sizeof(*set));
+    set->quiet = quiet;
+    char* servers_buf = strdup(servers);
+    set->keys_buf = strdup(keys ? keys : DEFAULT_SHARD_KEYS);
+    char** names = NULL;
+    int count = servers_buf && set->keys_buf ? split_list(servers_buf, &names) : -1;
+    set->nkeys = count > 0 ? split_list(set->keys_buf, &set->keys) : -1;
+    if (count <= 0 || set->nkeys < 0) {
+        fprintf(stderr, "Invalid server list: %s\n", servers);
+        free(names);
+        free(servers_buf);
+        free(set->keys_buf);
+        free(set->keys);
+        return -1;
+    }
+
+    set->shards = calloc((size_t)count, sizeof(*set->shards));
+    set->ring = calloc((size_t)count * SHARD_VNODES, sizeof(*set->ring));
+    for (int i = 0; set->shards && set->ring && i < count; i++) {
+        struct Shard* shard = &set->shards[set->count];
+        shard->server = strdup(names[i]);
+        shard->client = shard->server
+                            ? grpc_c_client_init(shard->server, "dumpclient", NULL, NULL)
+                            : NULL;
+        if (!shard->client) {
+            fprintf(stderr, "Failed to connect to %s\n", names[i]);
+            free(shard->server);
+            break;
+        }
+        set->count++;
+    }
+    free(names);
+    free(servers_buf);
+    if (set->count < count) {
+        shard_destroy(set);
+        return -1;
+    }
+
+    for (int i = 0; i < set->count; i++) {
+        for (int v = 0; v < SHARD_VNODES; v++) {
+            char label[512];
+            int n = snprintf(label, sizeof(label), "%s#%d", set->shards[i].server, v);
+            struct RingPoint* point = &set->ring[set->ring_len++];
+            point->hash = finish_hash(fnv1a(1469598103934665603ULL, label, (size_t)n));
+            point->shard = i;
+        }
+    }
+    qsort(set->ring, set->ring_len, sizeof(*set->ring), point_cmp);
+    pthread_mutex_init(&set->lock, NULL);
+    pthread_cond_init(&set->wake, NULL);
+    return 0;
+}
+
+void shard_destroy(struct ShardSet* set) {
+    if (set->running) {
+        pthread_mutex_lock(&set->lock);
+        set->stopping = 1;
+        pthread_cond_broadcast(&set->wake);
+        pthread_mutex_unlock(&set->lock);
+        pthread_join(set->thread, NULL);
+        set->running = 0;
+    }
+    for (int i = 0; i < set->count; i++) {
+        grpc_c_client_free(set->shards[i].client);
+        free(set->shards[i].server);
+    }
+    if (set->ring_len > 0) {
+        pthread_mutex_destroy(&set->lock);
+        pthread_cond_destroy(&set->wake);
+    }
+    free(set->shards);
+    free(set->ring);
+    free(set->keys);
+    free(set->keys_buf);
+    memset(set, 0, sizeof(*set));
+}
+
+static uint64_t shard_key(const struct ShardSet* set, const struct Metadata* md,
+                          const char* dump_path) {
+    uint64_t h = 1469598103934665603ULL;
+    int found = 0;
+    for (int k = 0; k < set->nkeys; k++) {
+        for (size_t i = 0; md && i < md->count; i++) {
+            if (strcmp(md->keys[i], set->keys[k]) == 0) {
+                h = fnv1a(h, md->keys[i], strlen(md->keys[i]) + 1);
+                h = fnv1a(h, md->values[i], strlen(md->values[i]) + 1);
+                found = 1;
+                break;
+            }
+        }
+    }
+    if (!found) {
+        h = fnv1a(h, dump_path, strlen(dump_path));
+    }
+    return finish_hash(h);
+}
+
+struct Shard* shard_pick(struct ShardSet* set, const struct Metadata* metadata,
+                         const char* dump_path) {
+    uint64_t h = shard_key(set, metadata, dump_path);
+    size_t lo = 0;
+    size_t hi = set->ring_len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (set->ring[mid].hash < h) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    struct Shard* shard = NULL;
+    pthread_mutex_lock(&set->lock);
+    for (size_t i = 0; i < set->ring_len; i++) {
+        struct Shard* s = &set->shards[set->ring[(lo + i) % set->ring_len].shard];
+        if (!s->down) {
+            shard = s;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&set->lock);
+    return shard;
+}
+
+static uint64_t check_delay_us(int failures) {
+    int shift = failures > 5 ? 5 : failures - 1;
+    unsigned int sec = 1u << (shift > 0 ? shift : 0);
+    return (uint64_t)(sec > MAX_CHECK_SEC ? MAX_CHECK_SEC : sec) * 1000000;
+}
+
+void shard_report(struct ShardSet* set, struct Shard* shard, int ok) {
+    pthread_mutex_lock(&set->lock);
+    if (ok) {
+        shard->sent++;
+        shard->failures = 0;
+    } else if (!shard->down) {
+        shard->down = 1;
+        shard->failures++;
+        shard->check_at_us = now_us() + check_delay_us(shard->failures);
+        if (!set->quiet) {
+            fprintf(stderr, "Server %s unreachable, removed from the ring\n", shard->server);
+        }
+        pthread_cond_broadcast(&set->wake);
+    }
+    pthread_mutex_unlock(&set->lock);
+}
+
+/* 用 QueryUpload 探测, 能得到响应即视为可用 */
+static int check_server(grpc_c_client_t* client) {
+    Dumptool__V1__UploadQuery query;
+    dumptool__v1__upload_query__init(&query);
+    Dumptool__V1__UploadStatus* status = NULL;
+    if (dumptool__v1__dump_service__query_upload(client, NULL, 0, &query, &status, NULL,
+                                                 CHECK_TIMEOUT_MS) != GRPC_C_OK || !status) {
+        return 0;
+    }
+    dumptool__v1__upload_status__free_unpacked(status, NULL);
+    return 1;
+}
+
+static void* check_main(void* arg) {
+    struct ShardSet* set = arg;
+    pthread_mutex_lock(&set->lock);
+    while (!set->stopping) {
+        uint64_t now = now_us();
+        for (int i = 0; i < set->count && !set->stopping; i++) {
+            struct Shard* shard = &set->shards[i];
+            if (!shard->down || shard->check_at_us > now) {
+                continue;
+            }
+            pthread_mutex_unlock(&set->lock);
+            int ok = check_server(shard->client);
+            pthread_mutex_lock(&set->lock);
+            if (ok) {
+                shard->down = 0;
+                shard->failures = 0;
+                if (!set->quiet) {
+                    fprintf(stderr, "Server %s is back\n", shard->server);
+                }
+            } else {
+                shard->failures++;
+                shard->check_at_us = now_us() + check_delay_us(shard->failures);
+            }
+        }
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += 1;
+        if (!set->stopping) {
+            pthread_cond_timedwait(&set->wake, &set->lock, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&set->lock);
+    return NULL;
+}
+
+int shard_start(struct ShardSet* set) {
+    if (pthread_create(&set->thread, NULL, check_main, set) != 0) {
+        fprintf(stderr, "Failed to start health checks\n");
+        return -1;
+    }
+    set->running = 1;
+    return 0;
+}
+
+void print_shard_stats(struct ShardSet* set) {
+    pthread_mutex_lock(&set->lock);
+    for (int i = 0; i < set->count; i++) {
+        const struct Shard* shard = &set->shards[i];
+        printf("Server %s: %zu dumps%s\n", shard->server, shard->sent,
+               shard->down ? " (down)" : "");
+    }
+    pthread_mutex_unlock(&set->lock);
+}
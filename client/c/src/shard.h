@@ -0,0 +1,65 @@
+#ifndef DUMPCLIENT_SHARD_H
+#define DUMPCLIENT_SHARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "generated/dumptool.grpc-c.h"
+
+#define SHARD_VNODES 160  // 每个服务端在环上的虚拟节点数
+#define DEFAULT_SHARD_KEYS "job,rank"
+
+struct Metadata;
+
+struct Shard {
+    char* server;
+    grpc_c_client_t* client;
+    int down;              // 已摘除, 由健康检查恢复
+    int failures;          // 连续失败次数, 决定下次检查的间隔
+    uint64_t check_at_us;
+    size_t sent;
+};
+
+struct RingPoint {
+    uint64_t hash;
+    int shard;
+};
+
+/*
+ * 多个服务端按 metadata 中的分片键做一致性哈希, 同一 job/rank 的 dump 总是落在同一服务端.
+ * 连接失败的服务端被摘除, 其上的键顺延到环上的下一个; 后台线程按指数退避探测,
+ * 探测成功后恢复, 键随之迁回.
+ */
+struct ShardSet {
+    struct Shard* shards;
+    int count;
+    struct RingPoint* ring;
+    size_t ring_len;
+    char* keys_buf;
+    char** keys;
+    int nkeys;
+    int quiet;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t thread;
+    int running;
+    int stopping;
+};
+
+/* servers 与 keys 均为逗号分隔的列表 */
+int shard_init(struct ShardSet* set, const char* servers, const char* keys, int quiet);
+void shard_destroy(struct ShardSet* set);
+
+/* 启动健康检查线程 */
+int shard_start(struct ShardSet* set);
+
+/* 按分片键 (都不存在时按 dump_path) 选择服务端, 全部被摘除时返回 NULL */
+struct Shard* shard_pick(struct ShardSet* set, const struct Metadata* metadata,
+                         const char* dump_path);
+
+/* 报告一次调用的结果, 连接失败时摘除该服务端 */
+void shard_report(struct ShardSet* set, struct Shard* shard, int ok);
+
+void print_shard_stats(struct ShardSet* set);
+
+#endif
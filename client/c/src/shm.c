@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "shm.h"
+
+int shm_ring_init(struct ShmRing* ring, size_t size) {
+    memset(ring, 0, sizeof(*ring));
+    snprintf(ring->name, sizeof(ring->name), "dumptool-%d-%lx", (int)getpid(),
+             (unsigned long)(uintptr_t)ring);
+    int fd = shm_open(ring->name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        perror("shm_open failed");
+        return -1;
+    }
+    if (ftruncate(fd, (off_t)size) < 0) {
+        perror("shm ftruncate failed");
+        close(fd);
+        shm_unlink(ring->name);
+        return -1;
+    }
+    void* addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        perror("shm mmap failed");
+        shm_unlink(ring->name);
+        return -1;
+    }
+    ring->base = addr;
+    ring->size = size;
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->space, NULL);
+    return 0;
+}
+
+void shm_ring_destroy(struct ShmRing* ring) {
+    if (!ring->base) {
+        return;
+    }
+    munmap(ring->base, ring->size);
+    shm_unlink(ring->name);
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->space);
+    free(ring->freed);
+    ring->base = NULL;
+}
+
+int shm_ring_alloc(struct ShmRing* ring, size_t len, struct ShmSlot* slot) {
+    if (len > ring->size) {
+        return -1;
+    }
+    pthread_mutex_lock(&ring->lock);
+    for (;;) {
+        /* 尾部剩余空间放不下时跳到段首, 跳过的部分随本区间一起释放 */
+        size_t pos = ring->head % ring->size;
+        size_t pad = pos + len > ring->size ? ring->size - pos : 0;
+        if (ring->head + pad + len - ring->tail <= ring->size) {
+            slot->start = ring->head;
+            slot->offset = (pos + pad) % ring->size;
+            slot->end = ring->head + pad + len;
+            ring->head = slot->end;
+            break;
+        }
+        pthread_cond_wait(&ring->space, &ring->lock);
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return 0;
+}
+
+void shm_ring_release(struct ShmRing* ring, const struct ShmSlot* slot) {
+    pthread_mutex_lock(&ring->lock);
+    if (slot->start != ring->tail) {
+        if (ring->nfreed == ring->freed_cap) {
+            size_t cap = ring->freed_cap ? ring->freed_cap * 2 : 16;
+            struct ShmSlot* freed = realloc(ring->freed, cap * sizeof(*freed));
+            if (!freed) {
+                pthread_mutex_unlock(&ring->lock);
+                return;  // 只泄漏这一段环空间
+            }
+            ring->freed = freed;
+            ring->freed_cap = cap;
+        }
+        ring->freed[ring->nfreed++] = *slot;
+        pthread_mutex_unlock(&ring->lock);
+        return;
+    }
+
+    ring->tail = slot->end;
+    for (size_t i = 0; i < ring->nfreed;) {
+        if (ring->freed[i].start == ring->tail) {
+            ring->tail = ring->freed[i].end;
+            ring->freed[i] = ring->freed[--ring->nfreed];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+    pthread_cond_broadcast(&ring->space);
+    pthread_mutex_unlock(&ring->lock);
+}
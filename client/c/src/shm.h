@@ -0,0 +1,45 @@
+#ifndef DUMPCLIENT_SHM_H
+#define DUMPCLIENT_SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define SHM_NAME_LEN 64
+
+/*
+ * /dev/shm 下的环形缓冲区, 同机的服务端按段名映射后直接读取 payload.
+ * 位置按逻辑偏移单调递增, 取模后得到段内偏移; 区间可乱序释放,
+ * 尾指针只在最早的区间释放后前移.
+ */
+struct ShmRing {
+    char name[SHM_NAME_LEN];
+    uint8_t* base;
+    size_t size;
+    pthread_mutex_t lock;
+    pthread_cond_t space;
+    uint64_t head;
+    uint64_t tail;
+    struct ShmSlot* freed;  // 已释放但尚未轮到尾部的区间
+    size_t nfreed;
+    size_t freed_cap;
+};
+
+struct ShmSlot {
+    uint64_t start;   // 含回绕时跳过的填充
+    uint64_t end;
+    size_t offset;    // 数据在段内的偏移
+};
+
+int shm_ring_init(struct ShmRing* ring, size_t size);
+void shm_ring_destroy(struct ShmRing* ring);
+
+/* 分配连续的 len 字节, 空间不足时阻塞; len 超过环大小返回 -1 */
+int shm_ring_alloc(struct ShmRing* ring, size_t len, struct ShmSlot* slot);
+void shm_ring_release(struct ShmRing* ring, const struct ShmSlot* slot);
+
+static inline uint8_t* shm_slot_data(const struct ShmRing* ring, const struct ShmSlot* slot) {
+    return ring->base + slot->offset;
+}
+
+#endif
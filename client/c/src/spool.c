@@ -0,0 +1,409 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include "client.h"
+
+#define SPOOL_QUEUE 1024
+#define RESCAN_SEC 60  // 上传失败的文件留在 spool 中, 每隔 RESCAN_SEC 重试
+#define QUIET_SEC 10   // 全量扫描时跳过最近修改过的文件, 它们可能仍在写入
+#define EVENT_BUF (64 * 1024)
+#define REJECTED_DIR ".rejected"  // 服务端拒绝的文件移到这里, 不再重试
+
+struct Spool {
+    grpc_c_client_t* client;
+    const struct CmdArgs* args;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    char* queue[SPOOL_QUEUE];
+    size_t head;
+    size_t count;
+    char** active;  // 每个工作线程正在上传的文件名
+    char** retry;   // 上传失败待重试的文件名
+    size_t n_retry;
+    size_t retry_cap;
+    int closing;
+    size_t files_ok;
+    size_t files_failed;
+};
+
+static volatile sig_atomic_t stopping;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stopping = 1;
+}
+
+/* 已在队列中或正在上传, 调用时持有 lock */
+static int is_pending(struct Spool* spool, const char* name) {
+    for (size_t i = 0; i < spool->count; i++) {
+        if (strcmp(spool->queue[(spool->head + i) % SPOOL_QUEUE], name) == 0) {
+            return 1;
+        }
+    }
+    for (int i = 0; i < spool->args->inflight; i++) {
+        if (spool->active[i] && strcmp(spool->active[i], name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * 以 . 开头的文件视为仍在写入, 写完后 rename 为正式文件名即可被拾取.
+ * quiet > 0 时 quiet 秒内修改过的文件可能仍在写入, 不入队并返回 1
+ */
+static int enqueue(struct Spool* spool, const char* name, int quiet) {
+    if (name[0] == '.') {
+        return 0;
+    }
+    char path[PATH_MAX];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s", spool->args->spool, name);
+    if (stat(path, &st) < 0 || !S_ISREG(st.st_mode)) {
+        return 0;
+    }
+    if (quiet > 0 && time(NULL) - st.st_mtime < quiet) {
+        return 1;
+    }
+
+    pthread_mutex_lock(&spool->lock);
+    while (spool->count == SPOOL_QUEUE) {
+        pthread_cond_wait(&spool->not_full, &spool->lock);
+    }
+    if (!is_pending(spool, name)) {
+        char* copy = strdup(name);
+        if (copy) {
+            spool->queue[(spool->head + spool->count) % SPOOL_QUEUE] = copy;
+            spool->count++;
+            pthread_cond_signal(&spool->not_empty);
+        }
+    }
+    pthread_mutex_unlock(&spool->lock);
+    return 0;
+}
+
+/* 记录上传失败或尚未静止的文件, 由 retry_failed 定期重新入队 */
+static void add_retry(struct Spool* spool, const char* name) {
+    pthread_mutex_lock(&spool->lock);
+    for (size_t i = 0; i < spool->n_retry; i++) {
+        if (strcmp(spool->retry[i], name) == 0) {
+            pthread_mutex_unlock(&spool->lock);
+            return;
+        }
+    }
+    if (spool->n_retry == spool->retry_cap) {
+        size_t cap = spool->retry_cap ? spool->retry_cap * 2 : 64;
+        char** retry = realloc(spool->retry, cap * sizeof(*retry));
+        if (!retry) {
+            pthread_mutex_unlock(&spool->lock);
+            return;
+        }
+        spool->retry = retry;
+        spool->retry_cap = cap;
+    }
+    char* copy = strdup(name);
+    if (copy) {
+        spool->retry[spool->n_retry++] = copy;
+    }
+    pthread_mutex_unlock(&spool->lock);
+}
+
+/*
+ * 启动时和 inotify 队列溢出时全量扫描. 最近修改过的文件先记入重试集合,
+ * 到时仍未静止再顺延, 写完关闭的 inotify 事件也会让它提前入队
+ */
+static void rescan(struct Spool* spool) {
+    DIR* dir = opendir(spool->args->spool);
+    if (!dir) {
+        perror("Spool scan failed");
+        return;
+    }
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (enqueue(spool, ent->d_name, QUIET_SEC)) {
+            add_retry(spool, ent->d_name);
+        }
+    }
+    closedir(dir);
+}
+
+static void retry_failed(struct Spool* spool) {
+    pthread_mutex_lock(&spool->lock);
+    char** retry = spool->retry;
+    size_t n = spool->n_retry;
+    spool->retry = NULL;
+    spool->n_retry = spool->retry_cap = 0;
+    pthread_mutex_unlock(&spool->lock);
+
+    for (size_t i = 0; i < n; i++) {
+        if (enqueue(spool, retry[i], QUIET_SEC)) {
+            add_retry(spool, retry[i]);
+        }
+        free(retry[i]);
+    }
+    free(retry);
+}
+
+/* 跨文件系统时 rename 返回 EXDEV, 改为复制后删除原文件 */
+static int copy_file(const char* src, const char* dest) {
+    int in = open(src, O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return -1;
+    }
+    int out = open(dest, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        close(in);
+        return -1;
+    }
+    char buf[64 * 1024];
+    ssize_t n;
+    int ret = 0;
+    while ((n = read(in, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ret = -1;
+            break;
+        }
+        for (ssize_t done = 0; done < n;) {
+            ssize_t w = write(out, buf + done, n - done);
+            if (w < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                ret = -1;
+                break;
+            }
+            done += w;
+        }
+        if (ret < 0) {
+            break;
+        }
+    }
+    if (ret == 0 && fsync(out) < 0) {
+        ret = -1;
+    }
+    close(in);
+    if (close(out) < 0) {
+        ret = -1;
+    }
+    if (ret < 0) {
+        int saved = errno;
+        unlink(dest);
+        errno = saved;
+    }
+    return ret;
+}
+
+static int move_file(const char* path, const char* dest) {
+    if (rename(path, dest) == 0) {
+        return 0;
+    }
+    if (errno != EXDEV || copy_file(path, dest) < 0) {
+        return -1;
+    }
+    return unlink(path);
+}
+
+/* 上传成功后删除或归档, 失败时保留原文件等待重试 */
+static void dispose(const struct CmdArgs* args, const char* path, const char* name) {
+    if (!args->archive) {
+        if (unlink(path) < 0) {
+            perror("Spool unlink failed");
+        }
+        return;
+    }
+    char dest[PATH_MAX];
+    snprintf(dest, sizeof(dest), "%s/%s", args->archive, name);
+    if (move_file(path, dest) < 0) {
+        fprintf(stderr, "Failed to archive %s: %s\n", path, strerror(errno));
+    }
+}
+
+/* 服务端拒绝的文件重发也不会成功, 移入 spool 下的 .rejected 目录留待人工处理 */
+static void reject(const struct CmdArgs* args, const char* path, const char* name) {
+    char dest[PATH_MAX];
+    snprintf(dest, sizeof(dest), "%s/%s", args->spool, REJECTED_DIR);
+    if (mkdir(dest, 0755) < 0 && errno != EEXIST) {
+        fprintf(stderr, "Cannot create %s: %s\n", dest, strerror(errno));
+        return;
+    }
+    snprintf(dest, sizeof(dest), "%s/%s/%s", args->spool, REJECTED_DIR, name);
+    if (rename(path, dest) < 0) {
+        fprintf(stderr, "Failed to move %s aside: %s\n", path, strerror(errno));
+        return;
+    }
+    fprintf(stderr, "%s: rejected by the server, moved to %s\n", path, dest);
+}
+
+struct Worker {
+    struct Spool* spool;
+    int id;
+};
+
+static void* worker_main(void* arg) {
+    struct Worker* worker = arg;
+    struct Spool* spool = worker->spool;
+    const struct CmdArgs* args = spool->args;
+
+    for (;;) {
+        pthread_mutex_lock(&spool->lock);
+        while (spool->count == 0 && !spool->closing) {
+            pthread_cond_wait(&spool->not_empty, &spool->lock);
+        }
+        if (spool->count == 0) {
+            pthread_mutex_unlock(&spool->lock);
+            return NULL;
+        }
+        char* name = spool->queue[spool->head];
+        spool->head = (spool->head + 1) % SPOOL_QUEUE;
+        spool->count--;
+        spool->active[worker->id] = name;
+        pthread_cond_signal(&spool->not_full);
+        pthread_mutex_unlock(&spool->lock);
+
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", args->spool, name);
+        char* dump_path = join_dump_path(args->dump_path, name);
+        int ret = dump_path ? send_file(spool->client, args, path, dump_path) : -1;
+        int ok = ret >= 0;
+        if (ok) {
+            dispose(args, path, name);
+        } else if (ret == SEND_REJECTED) {
+            reject(args, path, name);
+        } else {
+            fprintf(stderr, "%s: upload failed, retrying in %d s\n", path, RESCAN_SEC);
+            add_retry(spool, name);
+        }
+        free(dump_path);
+
+        pthread_mutex_lock(&spool->lock);
+        spool->active[worker->id] = NULL;
+        if (ok) {
+            spool->files_ok++;
+        } else {
+            spool->files_failed++;
+        }
+        pthread_mutex_unlock(&spool->lock);
+        free(name);
+    }
+}
+
+static void watch(struct Spool* spool, int fd) {
+    char* events = malloc(EVENT_BUF);
+    if (!events) {
+        return;
+    }
+    time_t last_scan = time(NULL);
+    struct pollfd pfd = { fd, POLLIN, 0 };
+
+    while (!stopping) {
+        int ready = poll(&pfd, 1, 1000);
+        if (ready < 0 && errno != EINTR) {
+            perror("Spool poll failed");
+            break;
+        }
+        if (ready > 0) {
+            ssize_t n = read(fd, events, EVENT_BUF);
+            for (char* p = events; n > 0 && p < events + n;) {
+                struct inotify_event* ev = (struct inotify_event*)p;
+                if (ev->mask & IN_Q_OVERFLOW) {
+                    rescan(spool);
+                } else if (ev->len > 0) {
+                    enqueue(spool, ev->name, 0);
+                }
+                p += sizeof(*ev) + ev->len;
+            }
+        }
+        if (time(NULL) - last_scan >= RESCAN_SEC) {
+            retry_failed(spool);
+            last_scan = time(NULL);
+        }
+    }
+    free(events);
+}
+
+int run_spool(grpc_c_client_t* client, const struct CmdArgs* args) {
+    int fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (fd < 0) {
+        perror("inotify init failed");
+        return -1;
+    }
+    if (inotify_add_watch(fd, args->spool, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        fprintf(stderr, "Cannot watch %s: %s\n", args->spool, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    struct Spool spool = {0};
+    spool.client = client;
+    spool.args = args;
+    spool.active = calloc(args->inflight, sizeof(*spool.active));
+    struct Worker* workers = calloc(args->inflight, sizeof(*workers));
+    pthread_t* threads = calloc(args->inflight, sizeof(*threads));
+    if (!spool.active || !workers || !threads) {
+        free(spool.active);
+        free(workers);
+        free(threads);
+        close(fd);
+        return -1;
+    }
+    pthread_mutex_init(&spool.lock, NULL);
+    pthread_cond_init(&spool.not_empty, NULL);
+    pthread_cond_init(&spool.not_full, NULL);
+
+    struct sigaction sa = {0};
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    int started = 0;
+    for (; started < args->inflight; started++) {
+        workers[started].spool = &spool;
+        workers[started].id = started;
+        if (pthread_create(&threads[started], NULL, worker_main, &workers[started]) != 0) {
+            break;
+        }
+    }
+
+    printf("Watching %s with %d workers\n", args->spool, started);
+    if (started > 0) {
+        /* 启动前遗留的文件, 先注册 watch 再扫描以免漏掉 */
+        rescan(&spool);
+        watch(&spool, fd);
+    }
+
+    pthread_mutex_lock(&spool.lock);
+    spool.closing = 1;
+    pthread_cond_broadcast(&spool.not_empty);
+    pthread_mutex_unlock(&spool.lock);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    printf("Spool: %zu files shipped (%zu failed)\n", spool.files_ok, spool.files_failed);
+
+    pthread_mutex_destroy(&spool.lock);
+    pthread_cond_destroy(&spool.not_empty);
+    pthread_cond_destroy(&spool.not_full);
+    for (size_t i = 0; i < spool.n_retry; i++) {
+        free(spool.retry[i]);
+    }
+    free(spool.retry);
+    free(spool.active);
+    free(workers);
+    free(threads);
+    close(fd);
+    return started > 0 ? 0 : -1;
+}
@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "client.h"
+
+#define MAX_BACKOFF_SEC 30
+
+struct Stripe {
+    grpc_c_client_t* client;
+    const struct CmdArgs* args;
+    const char* dump_path;
+    const char* upload_id;
+    uint8_t* payload;
+    size_t len;
+    size_t start;
+    size_t end;
+    int ret;
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* 条带内从 start 起已连续写入到的位置, 查询失败时从条带开头重传 */
+static size_t query_stripe(const struct Stripe* s) {
+    Dumptool__V1__UploadQuery query;
+    dumptool__v1__upload_query__init(&query);
+    query.upload_id = (char*)s->upload_id;
+
+    Dumptool__V1__UploadStatus* status = NULL;
+    if (dumptool__v1__dump_service__query_upload(s->client, NULL, 0, &query, &status,
+                                                 NULL, -1) != GRPC_C_OK || !status) {
+        return s->start;
+    }
+    size_t offset = s->start;
+    if (status->found && status->total_size == s->len) {
+        for (size_t i = 0; i < status->n_ranges; i++) {
+            const Dumptool__V1__ByteRange* r = status->ranges[i];
+            if (r->start <= s->start && s->start < r->end) {
+                offset = r->end < s->end ? r->end : s->end;
+                break;
+            }
+        }
+    }
+    dumptool__v1__upload_status__free_unpacked(status, NULL);
+    return offset;
+}
+
+static void* stripe_main(void* arg) {
+    struct Stripe* s = arg;
+    unsigned int backoff = 1;
+    for (int attempt = 0;; attempt++) {
+        size_t offset = query_stripe(s);
+        int ret = offset == s->end ? 0 :
+            upload_range(s->client, s->args, s->dump_path, s->upload_id, s->payload,
+                         s->len, offset, s->end);
+        if (ret == 0 || ret == SEND_LOCAL_ERROR || attempt >= s->args->retries) {
+            s->ret = ret;
+            return NULL;
+        }
+        fprintf(stderr, "Retrying stripe [%zu, %zu) in %u s (%d/%d)\n", s->start, s->end,
+                backoff, attempt + 1, s->args->retries);
+        sleep(backoff);
+        backoff = backoff * 2 > MAX_BACKOFF_SEC ? MAX_BACKOFF_SEC : backoff * 2;
+    }
+}
+
+static int commit_upload(grpc_c_client_t* client, const struct CmdArgs* args,
+                         const char* dump_path, const char* upload_id, size_t len,
+                         uint8_t digest[DIGEST_LEN]) {
+    Dumptool__V1__CommitRequest req;
+    dumptool__v1__commit_request__init(&req);
+    req.upload_id = (char*)upload_id;
+    req.dump_path = (char*)dump_path;
+    req.total_size = len;
+    req.digest.data = digest;
+    req.digest.len = DIGEST_LEN;
+
+    Dumptool__V1__DumpResponse* resp = NULL;
+    unsigned int backoff = 1;
+    for (int attempt = 0;; attempt++) {
+        if (dumptool__v1__dump_service__commit_upload(client, NULL, 0, &req, &resp,
+                                                      NULL, -1) == GRPC_C_OK && resp) {
+            break;
+        }
+        if (attempt >= args->retries) {
+            fprintf(stderr, "CommitUpload failed\n");
+            return -1;
+        }
+        sleep(backoff);
+        backoff = backoff * 2 > MAX_BACKOFF_SEC ? MAX_BACKOFF_SEC : backoff * 2;
+    }
+
+    if (!args->quiet) {
+        printf("Response: %s (%s)\n", resp->success ? "OK" : "FAILED", resp->message);
+    } else if (!resp->success) {
+        fprintf(stderr, "CommitUpload %s: %s\n", dump_path, resp->message);
+    }
+    int ret = resp->success ? 0 : SEND_REJECTED;
+    dumptool__v1__dump_response__free_unpacked(resp, NULL);
+    return ret;
+}
+
+int stripe_upload(const struct CmdArgs* args, const char* dump_path,
+                  const char* upload_id, uint8_t* payload, size_t len) {
+    int n = args->nchannels;
+    size_t per = (len + n - 1) / n;
+    per = (per + args->chunk_size - 1) / args->chunk_size * args->chunk_size;
+
+    struct Stripe* stripes = calloc(n, sizeof(*stripes));
+    pthread_t* threads = calloc(n, sizeof(*threads));
+    if (!stripes || !threads) {
+        free(stripes);
+        free(threads);
+        return SEND_LOCAL_ERROR;
+    }
+
+    /* 各条带的响应不逐条打印 */
+    struct CmdArgs stripe_args = *args;
+    stripe_args.quiet = 1;
+
+    double start = now_sec();
+    int started = 0;
+    for (int i = 0; i < n && (size_t)i * per < len; i++) {
+        struct Stripe* s = &stripes[i];
+        s->client = args->channels[i];
+        s->args = &stripe_args;
+        s->dump_path = dump_path;
+        s->upload_id = upload_id;
+        s->payload = payload;
+        s->len = len;
+        s->start = (size_t)i * per;
+        s->end = s->start + per < len ? s->start + per : len;
+        if (pthread_create(&threads[i], NULL, stripe_main, s) != 0) {
+            break;
+        }
+        started++;
+    }
+
+    /* 条带发送期间在本线程计算整体摘要 */
+    uint8_t digest[DIGEST_LEN];
+    payload_digest(args, payload, len, digest);
+
+    /* 线程未能全部启动属于本地错误; 条带失败时优先报告传输失败 */
+    int ret = started > 0 && (size_t)started * per >= len ? 0 : SEND_LOCAL_ERROR;
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        if (stripes[i].ret < 0 && ret != -1) {
+            ret = stripes[i].ret;
+        }
+    }
+    if (ret == 0) {
+        ret = commit_upload(args->channels[0], args, dump_path, upload_id, len, digest);
+    }
+
+    double elapsed = now_sec() - start;
+    if (ret == 0 && !args->quiet && elapsed > 0) {
+        printf("Striped upload: %d stripes, %.2f MB in %.3f s, %.2f MB/s\n",
+               started, len / 1e6, elapsed, len / 1e6 / elapsed);
+    }
+    free(stripes);
+    free(threads);
+    return ret;
+}
+
+int open_channels(struct CmdArgs* args, grpc_c_client_t* primary, int n) {
+    args->channels = calloc(n, sizeof(*args->channels));
+    if (!args->channels) {
+        return -1;
+    }
+    args->channels[0] = primary;
+    args->nchannels = 1;
+
+    /* 默认同一目标的 channel 共享子通道, 即同一条 TCP 连接 */
+    grpc_arg arg;
+    arg.type = GRPC_ARG_INTEGER;
+    arg.key = (char*)GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL;
+    arg.value.integer = 1;
+    grpc_channel_args channel_args = { 1, &arg };
+
+    for (int i = 1; i < n; i++) {
+        args->channels[i] = grpc_c_client_init(args->server, "dumpclient", NULL, &channel_args);
+        if (!args->channels[i]) {
+            fprintf(stderr, "Failed to open channel %d to %s\n", i, args->server);
+            close_channels(args);
+            return -1;
+        }
+        args->nchannels++;
+    }
+    return 0;
+}
+
+void close_channels(struct CmdArgs* args) {
+    for (int i = 1; i < args->nchannels; i++) {
+        grpc_c_client_free(args->channels[i]);
+    }
+    free(args->channels);
+    args->channels = NULL;
+    args->nchannels = 0;
+}
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+#include "client.h"
+
+#define HASH_STEP (4 * 1024 * 1024)
+#define MAX_BACKOFF_SEC 30
+
+int make_upload_id(const char* filename, const char* dump_path,
+                   char id[UPLOAD_ID_LEN + 1]) {
+    struct stat st;
+    if (stat(filename, &st) < 0) {
+        return -1;
+    }
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+
+    char key[4096];
+    int n = snprintf(key, sizeof(key), "%s\n%s\n%lu:%lu:%lld:%lld.%09ld", host, dump_path,
+                     (unsigned long)st.st_dev, (unsigned long)st.st_ino,
+                     (long long)st.st_size, (long long)st.st_mtim.tv_sec,
+                     st.st_mtim.tv_nsec);
+    if (n < 0 || (size_t)n >= sizeof(key)) {
+        return -1;
+    }
+
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+    EVP_Digest(key, (size_t)n, digest, &digest_len, EVP_sha256(), NULL);
+    for (int i = 0; i < UPLOAD_ID_LEN / 2; i++) {
+        sprintf(id + 2 * i, "%02x", digest[i]);
+    }
+    id[UPLOAD_ID_LEN] = '\0';
+    return 0;
+}
+
+/* 服务端已提交的字节数, 查询失败或与本地文件不一致时从头上传 */
+static size_t query_committed(grpc_c_client_t* client, const char* upload_id, size_t len) {
+    Dumptool__V1__UploadQuery query;
+    dumptool__v1__upload_query__init(&query);
+    query.upload_id = (char*)upload_id;
+
+    Dumptool__V1__UploadStatus* status = NULL;
+    if (dumptool__v1__dump_service__query_upload(client, NULL, 0, &query, &status,
+                                                 NULL, -1) != GRPC_C_OK || !status) {
+        return 0;
+    }
+    size_t committed = 0;
+    if (status->found && status->total_size == len && status->committed_size <= len) {
+        committed = status->committed_size;
+    }
+    dumptool__v1__upload_status__free_unpacked(status, NULL);
+    return committed;
+}
+
+int upload_range(grpc_c_client_t* client, const struct CmdArgs* args,
+                 const char* dump_path, const char* upload_id,
+                 uint8_t* payload, size_t len, size_t offset, size_t stripe_end) {
+    /* 本地资源先于建立调用分配, 失败时不必结束已开始的流 */
+    const struct Codec* codec = codec_active(&args->codec);
+    int compress = codec->type != DUMPTOOL__V1__DUMP_REQUEST__COMPRESSION__NONE;
+    size_t scratch_cap = compress ? codec_bound(codec, args->chunk_size) : 0;
+    uint8_t* scratch = compress ? malloc(scratch_cap) : NULL;
+    /* 条带不带摘要, 整体摘要由 CommitUpload 提交 */
+    EVP_MD_CTX* md = stripe_end ? NULL : EVP_MD_CTX_new();
+    if ((compress && !scratch) || (!stripe_end && !md)) {
+        fprintf(stderr, "Out of memory for upload buffers\n");
+        free(scratch);
+        EVP_MD_CTX_free(md);
+        return SEND_LOCAL_ERROR;
+    }
+    if (md) {
+        EVP_DigestInit_ex(md, EVP_sha256(), NULL);
+    }
+    size_t start = offset;
+    size_t end = stripe_end ? stripe_end : len;
+    struct CodecStats stats = { end - offset, 0, 0 };
+
+    grpc_c_context_t* ctx = NULL;
+    if (dumptool__v1__dump_service__upload_dump(client, NULL, 0, &ctx) != GRPC_C_OK || !ctx) {
+        fprintf(stderr, "UploadDump failed to start\n");
+        free(scratch);
+        EVP_MD_CTX_free(md);
+        return -1;
+    }
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+
+    /* 续传时摘要仍覆盖整个 payload, 已提交部分只在本地计算 */
+    for (size_t pos = 0; md && pos < offset; pos += HASH_STEP) {
+        size_t n = offset - pos < HASH_STEP ? offset - pos : HASH_STEP;
+        EVP_DigestUpdate(md, payload + pos, n);
+        release_pages(args, payload, pos, n);
+    }
+
+    Dumptool__V1__DumpChunk__MetadataEntry entries[MAX_METADATA];
+    Dumptool__V1__DumpChunk__MetadataEntry* ptrs[MAX_METADATA];
+
+    int ret = 0;
+    int first = 1;
+    do {
+        size_t n = end - offset < args->chunk_size ? end - offset : args->chunk_size;
+
+        Dumptool__V1__DumpChunk chunk;
+        dumptool__v1__dump_chunk__init(&chunk);
+        if (first) {
+            chunk.dump_path = (char*)dump_path;
+            chunk.format = args->format;
+            chunk.total_size = len;
+            chunk.compression = codec->type;
+            chunk.compression_level = codec->level;
+            if (upload_id) {
+                chunk.upload_id = (char*)upload_id;
+            }
+            chunk.stripe_end = stripe_end;
+            FILL_METADATA(&chunk, entries, ptrs,
+                          dumptool__v1__dump_chunk__metadata_entry__init, &args->metadata);
+            first = 0;
+        }
+        chunk.offset = offset;
+        chunk.data.data = payload + offset;
+        chunk.data.len = n;
+        if (compress) {
+            uint64_t t0 = thread_cpu_us();
+            chunk.data.len = codec_compress(codec, payload + offset, n, scratch, scratch_cap);
+            stats.cpu_us += thread_cpu_us() - t0;
+            if (chunk.data.len == 0) {
+                ret = SEND_LOCAL_ERROR;
+                break;
+            }
+            chunk.data.data = scratch;
+        }
+        stats.wire_bytes += chunk.data.len;
+
+        if (md) {
+            EVP_DigestUpdate(md, payload + offset, n);
+        }
+        if (md && offset + n == len) {
+            EVP_DigestFinal_ex(md, digest, &digest_len);
+            chunk.digest.data = digest;
+            chunk.digest.len = digest_len;
+        }
+
+        limiter_acquire(args->limiter, chunk.data.len);
+        if (ctx->gcc_stream->write(ctx, &chunk, 0, -1) != GRPC_C_OK) {
+            fprintf(stderr, "UploadDump write failed at offset %zu\n", offset);
+            ret = -1;
+            break;
+        }
+        release_pages(args, payload, offset, n);
+        offset += n;
+    } while (offset < end);
+    EVP_MD_CTX_free(md);
+    free(scratch);
+
+    Dumptool__V1__DumpResponse* resp = NULL;
+    if (ret == 0) {
+        ctx->gcc_stream->write_done(ctx, 0, -1);
+        if (ctx->gcc_stream->read(ctx, (void**)&resp, 0, -1) != GRPC_C_OK) {
+            resp = NULL;
+        }
+    }
+
+    grpc_c_status_t status;
+    ctx->gcc_stream->finish(ctx, &status, 0);
+    if (ret == SEND_LOCAL_ERROR) {
+        return ret;
+    }
+    if (!resp) {
+        fprintf(stderr, "UploadDump failed (status %d)\n", status.gcs_code);
+        return -1;
+    }
+
+    if (resp->compression_unsupported && compress) {
+        dumptool__v1__dump_response__free_unpacked(resp, NULL);
+        codec_disable(codec);
+        return upload_range(client, args, dump_path, upload_id, payload, len, start, stripe_end);
+    }
+
+    if (!args->quiet) {
+        printf("Response: %s (%s)\n", resp->success ? "OK" : "FAILED", resp->message);
+        print_codec_stats(codec, &stats, resp->decode_cpu_us);
+    } else if (!resp->success) {
+        fprintf(stderr, "UploadDump %s: %s\n", dump_path, resp->message);
+    }
+    limiter_backoff(args->limiter, resp->retry_after_ms);
+    ret = resp->success ? 0 : SEND_REJECTED;
+    dumptool__v1__dump_response__free_unpacked(resp, NULL);
+    return ret;
+}
+
+int upload_dump(grpc_c_client_t* client, const struct CmdArgs* args,
+                const char* dump_path, const char* upload_id,
+                uint8_t* payload, size_t len) {
+    if (!upload_id) {
+        return upload_range(client, args, dump_path, NULL, payload, len, 0, 0);
+    }
+
+    unsigned int backoff = 1;
+    for (int attempt = 0;; attempt++) {
+        size_t offset = query_committed(client, upload_id, len);
+        if (offset > 0 && !args->quiet) {
+            printf("Resuming upload %s at offset %zu of %zu\n", upload_id, offset, len);
+        }
+        int ret = upload_range(client, args, dump_path, upload_id, payload, len, offset, 0);
+        if (ret == 0 || ret == SEND_LOCAL_ERROR || ret == SEND_REJECTED ||
+            attempt >= args->retries) {
+            return ret;
+        }
+        fprintf(stderr, "Retrying upload %s in %u s (%d/%d)\n", upload_id, backoff,
+                attempt + 1, args->retries);
+        sleep(backoff);
+        backoff = backoff * 2 > MAX_BACKOFF_SEC ? MAX_BACKOFF_SEC : backoff * 2;
+    }
+}
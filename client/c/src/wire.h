@@ -0,0 +1,81 @@
+#ifndef DUMPCLIENT_WIRE_H
+#define DUMPCLIENT_WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* protobuf wire format 的最小读写, 供不链接 schema 的 payload 扫描使用 */
+
+enum { WT_VARINT = 0, WT_I64 = 1, WT_LEN = 2, WT_I32 = 5 };
+
+struct WireField {
+    uint32_t number;
+    int wire_type;
+    uint64_t value;       // varint 的值, 或长度字段的长度
+    const uint8_t* data;  // 长度字段的内容
+    size_t len;
+    const uint8_t* start;  // 含 tag 的完整编码
+};
+
+static inline int wire_read_varint(const uint8_t** p, const uint8_t* end, uint64_t* v) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+        uint8_t b = *(*p)++;
+        result |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* 读一个字段并跳过其内容, 编码不合法 (含 group) 时返回 -1 */
+static inline int wire_next_field(const uint8_t** p, const uint8_t* end, struct WireField* f) {
+    uint64_t key;
+    f->start = *p;
+    if (wire_read_varint(p, end, &key) < 0 || (key >> 3) == 0 || (key >> 3) > UINT32_MAX) {
+        return -1;
+    }
+    f->number = (uint32_t)(key >> 3);
+    f->wire_type = (int)(key & 7);
+    switch (f->wire_type) {
+    case WT_VARINT:
+        return wire_read_varint(p, end, &f->value);
+    case WT_I64:
+        if (end - *p < 8) {
+            return -1;
+        }
+        *p += 8;
+        return 0;
+    case WT_I32:
+        if (end - *p < 4) {
+            return -1;
+        }
+        *p += 4;
+        return 0;
+    case WT_LEN:
+        if (wire_read_varint(p, end, &f->value) < 0 || f->value > (uint64_t)(end - *p)) {
+            return -1;
+        }
+        f->data = *p;
+        f->len = (size_t)f->value;
+        *p += f->len;
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+/* out 至少 10 字节, 返回写入的字节数 */
+static inline size_t wire_put_varint(uint8_t* out, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+#endif
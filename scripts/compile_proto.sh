@@ -16,4 +16,14 @@ python -m grpc_tools.protoc \
     --grpc_python_out=server/python/generated \
     proto/dumptool.proto
 
+# 服务端转换流水线调用的转换脚本
+python -m grpc_tools.protoc \
+    -Iconverttool/flamegraph \
+    --python_out=converttool/flamegraph \
+    converttool/flamegraph/mem_profile.proto
+python -m grpc_tools.protoc \
+    -Iprototest/timeline/test \
+    --python_out=prototest/timeline/test \
+    prototest/timeline/test/timeline.proto
+
 echo "Protocol files generated successfully"
@@ -1,4 +1,9 @@
 #!/bin/bash
 
-cd server/python3/src
-python33 server.py
\ No newline at end of file
+# 用法: scripts/start_server.sh [server.py 参数...]
+# 默认单进程运行; PROCESSES=N 启动 N 个工作进程共同监听同一端口 (SO_REUSEPORT), 0 为每个 CPU 核一个
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+export PYTHONPATH="$ROOT/server/python:$ROOT/server/python/generated${PYTHONPATH:+:$PYTHONPATH}"
+
+cd "$ROOT/server/python/src"
+exec python3 server.py --processes "${PROCESSES:-1}" "$@"
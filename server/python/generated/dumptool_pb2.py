@@ -24,7 +24,7 @@ _sym_db = _symbol_database.Default()
 
 
 
-DESCRIPTOR = _descriptor_pool.Default().AddSerializedFile(b'\n\x0e\x64umptool.proto\x12\x0b\x64umptool.v1\"\x83\x02\n\x0b\x44umpRequest\x12\x11\n\tdump_path\x18\x01 \x01(\t\x12\x0f\n\x07payload\x18\x02 \x01(\x0c\x12\x33\n\x06\x66ormat\x18\x03 \x01(\x0e\x32#.dumptool.v1.DumpRequest.DataFormat\x12\x38\n\x08metadata\x18\x04 \x03(\x0b\x32&.dumptool.v1.DumpRequest.MetadataEntry\x1a/\n\rMetadataEntry\x12\x0b\n\x03key\x18\x01 \x01(\t\x12\r\n\x05value\x18\x02 \x01(\t:\x02\x38\x01\"0\n\nDataFormat\x12\x08\n\x04JSON\x10\x00\x12\x0c\n\x08PROTOBUF\x10\x01\x12\n\n\x06\x42INARY\x10\x02\"0\n\x0c\x44umpResponse\x12\x0f\n\x07success\x18\x01 \x01(\x08\x12\x0f\n\x07message\x18\x02 \x01(\t2N\n\x0b\x44umpService\x12?\n\x08SendDump\x12\x18.dumptool.v1.DumpRequest\x1a\x19.dumptool.v1.DumpResponseb\x06proto3')
+DESCRIPTOR = _descriptor_pool.Default().AddSerializedFile(b'\n\x0e\x64umptool.proto\x12\x0b\x64umptool.v1\"\x97\x03\n\x0b\x44umpRequest\x12\x11\n\tdump_path\x18\x01 \x01(\t\x12\x0f\n\x07payload\x18\x02 \x01(\x0c\x12\x33\n\x06\x66ormat\x18\x03 \x01(\x0e\x32#.dumptool.v1.DumpRequest.DataFormat\x12\x38\n\x08metadata\x18\x04 \x03(\x0b\x32&.dumptool.v1.DumpRequest.MetadataEntry\x12\x39\n\x0b\x63ompression\x18\x05 \x01(\x0e\x32$.dumptool.v1.DumpRequest.Compression\x12\x19\n\x11\x63ompression_level\x18\x06 \x01(\x05\x12\x10\n\x08raw_size\x18\x07 \x01(\x04\x1a/\n\rMetadataEntry\x12\x0b\n\x03key\x18\x01 \x01(\t\x12\r\n\x05value\x18\x02 \x01(\t:\x02\x38\x01\"0\n\nDataFormat\x12\x08\n\x04JSON\x10\x00\x12\x0c\n\x08PROTOBUF\x10\x01\x12\n\n\x06\x42INARY\x10\x02\"*\n\x0b\x43ompression\x12\x08\n\x04NONE\x10\x00\x12\x07\n\x03LZ4\x10\x01\x12\x08\n\x04ZSTD\x10\x02\"\xfb\x02\n\tDumpChunk\x12\x11\n\tdump_path\x18\x01 \x01(\t\x12\x33\n\x06\x66ormat\x18\x02 \x01(\x0e\x32#.dumptool.v1.DumpRequest.DataFormat\x12\x36\n\x08metadata\x18\x03 \x03(\x0b\x32$.dumptool.v1.DumpChunk.MetadataEntry\x12\x12\n\ntotal_size\x18\x04 \x01(\x04\x12\x0e\n\x06offset\x18\x05 \x01(\x04\x12\x0c\n\x04\x64\x61ta\x18\x06 \x01(\x0c\x12\x0e\n\x06\x64igest\x18\x07 \x01(\x0c\x12\x39\n\x0b\x63ompression\x18\x08 \x01(\x0e\x32$.dumptool.v1.DumpRequest.Compression\x12\x19\n\x11\x63ompression_level\x18\t \x01(\x05\x12\x11\n\tupload_id\x18\n \x01(\t\x12\x12\n\nstripe_end\x18\x0b \x01(\x04\x1a/\n\rMetadataEntry\x12\x0b\n\x03key\x18\x01 \x01(\t\x12\r\n\x05value\x18\x02 \x01(\t:\x02\x38\x01\" \n\x0bUploadQuery\x12\x11\n\tupload_id\x18\x01 \x01(\t\"q\n\x0cUploadStatus\x12\r\n\x05\x66ound\x18\x01 \x01(\x08\x12\x16\n\x0e\x63ommitted_size\x18\x02 \x01(\x04\x12\x12\n\ntotal_size\x18\x03 \x01(\x04\x12&\n\x06ranges\x18\x04 \x03(\x0b\x32\x16.dumptool.v1.ByteRange\"\'\n\tByteRange\x12\r\n\x05start\x18\x01 \x01(\x04\x12\x0b\n\x03\x65nd\x18\x02 \x01(\x04\"Y\n\rCommitRequest\x12\x11\n\tupload_id\x18\x01 \x01(\t\x12\x11\n\tdump_path\x18\x02 \x01(\t\x12\x12\n\ntotal_size\x18\x03 \x01(\x04\x12\x0e\n\x06\x64igest\x18\x04 \x01(\x0c\"\xe0\x01\n\x0cProbeRequest\x12\x11\n\tdump_path\x18\x01 \x01(\t\x12\x33\n\x06\x66ormat\x18\x02 \x01(\x0e\x32#.dumptool.v1.DumpRequest.DataFormat\x12\x39\n\x08metadata\x18\x03 \x03(\x0b\x32\'.dumptool.v1.ProbeRequest.MetadataEntry\x12\x0e\n\x06\x64igest\x18\x04 \x01(\x0c\x12\x0c\n\x04size\x18\x05 \x01(\x04\x1a/\n\rMetadataEntry\x12\x0b\n\x03key\x18\x01 \x01(\t\x12\r\n\x05value\x18\x02 \x01(\t:\x02\x38\x01\"1\n\rProbeResponse\x12\x0f\n\x07present\x18\x01 \x01(\x08\x12\x0f\n\x07message\x18\x02 \x01(\t\"\xf7\x01\n\x0eShmDumpRequest\x12\x11\n\tdump_path\x18\x01 \x01(\t\x12\x33\n\x06\x66ormat\x18\x02 \x01(\x0e\x32#.dumptool.v1.DumpRequest.DataFormat\x12;\n\x08metadata\x18\x03 \x03(\x0b\x32).dumptool.v1.ShmDumpRequest.MetadataEntry\x12\x0f\n\x07segment\x18\x04 \x01(\t\x12\x0e\n\x06offset\x18\x05 \x01(\x04\x12\x0e\n\x06length\x18\x06 \x01(\x04\x1a/\n\rMetadataEntry\x12\x0b\n\x03key\x18\x01 \x01(\t\x12\r\n\x05value\x18\x02 \x01(\t:\x02\x38\x01\"\x80\x01\n\x0c\x44umpResponse\x12\x0f\n\x07success\x18\x01 \x01(\x08\x12\x0f\n\x07message\x18\x02 \x01(\t\x12\x15\n\rdecode_cpu_us\x18\x03 \x01(\x04\x12\x16\n\x0eretry_after_ms\x18\x04 \x01(\r\x12\x1f\n\x17\x63ompression_unsupported\x18\x05 \x01(\x08\"B\n\x0bSessionDump\x12\x0b\n\x03seq\x18\x01 \x01(\x04\x12&\n\x04\x64ump\x18\x02 \x01(\x0b\x32\x18.dumptool.v1.DumpRequest\".\n\x0eSessionFailure\x12\x0b\n\x03seq\x18\x01 \x01(\x04\x12\x0f\n\x07message\x18\x02 \x01(\t\"r\n\nSessionAck\x12\r\n\x05\x61\x63ked\x18\x01 \x01(\x04\x12-\n\x08\x66\x61ilures\x18\x02 \x03(\x0b\x32\x1b.dumptool.v1.SessionFailure\x12\x0e\n\x06\x63redit\x18\x03 \x01(\x04\x12\x16\n\x0eretry_after_ms\x18\x04 \x01(\r\"\x0e\n\x0cStatsRequest\"0\n\rLatencyBucket\x12\x10\n\x08upper_us\x18\x01 \x01(\x04\x12\r\n\x05\x63ount\x18\x02 \x01(\x04\"\xbe\x01\n\x10LatencyHistogram\x12\r\n\x05stage\x18\x01 \x01(\t\x12\r\n\x05\x63ount\x18\x02 \x01(\x04\x12\x0e\n\x06sum_us\x18\x03 \x01(\x04\x12\x0e\n\x06max_us\x18\x04 \x01(\x04\x12\x0e\n\x06p50_us\x18\x05 \x01(\x04\x12\x0e\n\x06p90_us\x18\x06 \x01(\x04\x12\x0e\n\x06p99_us\x18\x07 \x01(\x04\x12\x0f\n\x07p999_us\x18\x08 \x01(\x04\x12+\n\x07\x62uckets\x18\t \x03(\x0b\x32\x1a.dumptool.v1.LatencyBucket\"\xb2\x02\n\x0b\x46ormatStats\x12\x33\n\x06\x66ormat\x18\x01 \x01(\x0e\x32#.dumptool.v1.DumpRequest.DataFormat\x12\x10\n\x08requests\x18\x02 \x01(\x04\x12\x10\n\x08\x66\x61ilures\x18\x03 \x01(\x04\x12\x0c\n\x04\x62usy\x18\x04 \x01(\x04\x12\x10\n\x08\x62ytes_in\x18\x05 \x01(\x04\x12\x11\n\traw_bytes\x18\x06 \x01(\x04\x12\x18\n\x10requests_per_sec\x18\x07 \x01(\x01\x12\x15\n\rbytes_per_sec\x18\x08 \x01(\x01\x12\x10\n\x08inflight\x18\t \x01(\r\x12\x14\n\x0cmax_inflight\x18\n \x01(\r\x12\x0e\n\x06queued\x18\x0b \x01(\r\x12.\n\x07latency\x18\x0c \x03(\x0b\x32\x1d.dumptool.v1.LatencyHistogram\"\xe5\x01\n\rStatsResponse\x12\x0b\n\x03pid\x18\x01 \x01(\r\x12\x12\n\nuptime_sec\x18\x02 \x01(\x01\x12\x12\n\nqueue_jobs\x18\x03 \x01(\r\x12\x13\n\x0bqueue_bytes\x18\x04 \x01(\x04\x12\r\n\x05syncs\x18\x05 \x01(\x04\x12\x14\n\x0csynced_dumps\x18\x06 \x01(\x04\x12)\n\x07\x66ormats\x18\x07 \x03(\x0b\x32\x18.dumptool.v1.FormatStats\x12:\n\x0c\x63ompressions\x18\x08 \x03(\x0e\x32$.dumptool.v1.DumpRequest.Compression\"\xe8\x01\n\x0f\x46lamegraphQuery\x12\x0b\n\x03job\x18\x01 \x01(\t\x12\r\n\x05ranks\x18\x02 \x03(\r\x12\x36\n\x06stages\x18\x03 \x03(\x0e\x32&.dumptool.v1.FlamegraphQuery.StageType\x12\x12\n\nstep_begin\x18\x04 \x01(\x04\x12\x10\n\x08step_end\x18\x05 \x01(\x04\x12\x11\n\tmax_nodes\x18\x06 \x01(\r\"H\n\tStageType\x12\x14\n\x10STAGE_DATALOADER\x10\x00\x12\x11\n\rSTAGE_FORWARD\x10\x01\x12\x12\n\x0eSTAGE_BACKWARD\x10\x02\"7\n\tFlameNode\x12\x0c\n\x04name\x18\x01 \x01(\t\x12\x0c\n\x04size\x18\x02 \x01(\x04\x12\x0e\n\x06parent\x18\x03 \x01(\r\"\x91\x01\n\x12\x46lamegraphResponse\x12\x0f\n\x07success\x18\x01 \x01(\x08\x12\x0f\n\x07message\x18\x02 \x01(\t\x12%\n\x05nodes\x18\x03 \x03(\x0b\x32\x16.dumptool.v1.FlameNode\x12\r\n\x05\x64umps\x18\x04 \x01(\r\x12\x13\n\x0btotal_nodes\x18\x05 \x01(\x04\x12\x0e\n\x06\x63\x61\x63hed\x18\x06 \x01(\x08\x32\x82\x05\n\x0b\x44umpService\x12?\n\x08SendDump\x12\x18.dumptool.v1.DumpRequest\x1a\x19.dumptool.v1.DumpResponse\x12\x41\n\nUploadDump\x12\x16.dumptool.v1.DumpChunk\x1a\x19.dumptool.v1.DumpResponse(\x01\x12\x42\n\x0bQueryUpload\x12\x18.dumptool.v1.UploadQuery\x1a\x19.dumptool.v1.UploadStatus\x12\x42\n\tProbeDump\x12\x19.dumptool.v1.ProbeRequest\x1a\x1a.dumptool.v1.ProbeResponse\x12\x45\n\x0bSendShmDump\x12\x1b.dumptool.v1.ShmDumpRequest\x1a\x19.dumptool.v1.DumpResponse\x12\x45\n\x0c\x43ommitUpload\x12\x1a.dumptool.v1.CommitRequest\x1a\x19.dumptool.v1.DumpResponse\x12\x44\n\x0b\x44umpSession\x12\x18.dumptool.v1.SessionDump\x1a\x17.dumptool.v1.SessionAck(\x01\x30\x01\x12\x41\n\x08GetStats\x12\x19.dumptool.v1.StatsRequest\x1a\x1a.dumptool.v1.StatsResponse\x12P\n\x0fQueryFlamegraph\x12\x1c.dumptool.v1.FlamegraphQuery\x1a\x1f.dumptool.v1.FlamegraphResponseb\x06proto3')
 
 _globals = globals()
 _builder.BuildMessageAndEnumDescriptors(DESCRIPTOR, _globals)
@@ -33,14 +33,68 @@ if not _descriptor._USE_C_DESCRIPTORS:
   DESCRIPTOR._loaded_options = None
   _globals['_DUMPREQUEST_METADATAENTRY']._loaded_options = None
   _globals['_DUMPREQUEST_METADATAENTRY']._serialized_options = b'8\001'
+  _globals['_DUMPCHUNK_METADATAENTRY']._loaded_options = None
+  _globals['_DUMPCHUNK_METADATAENTRY']._serialized_options = b'8\001'
+  _globals['_PROBEREQUEST_METADATAENTRY']._loaded_options = None
+  _globals['_PROBEREQUEST_METADATAENTRY']._serialized_options = b'8\001'
+  _globals['_SHMDUMPREQUEST_METADATAENTRY']._loaded_options = None
+  _globals['_SHMDUMPREQUEST_METADATAENTRY']._serialized_options = b'8\001'
   _globals['_DUMPREQUEST']._serialized_start=32
-  _globals['_DUMPREQUEST']._serialized_end=291
-  _globals['_DUMPREQUEST_METADATAENTRY']._serialized_start=194
-  _globals['_DUMPREQUEST_METADATAENTRY']._serialized_end=241
-  _globals['_DUMPREQUEST_DATAFORMAT']._serialized_start=243
-  _globals['_DUMPREQUEST_DATAFORMAT']._serialized_end=291
-  _globals['_DUMPRESPONSE']._serialized_start=293
-  _globals['_DUMPRESPONSE']._serialized_end=341
-  _globals['_DUMPSERVICE']._serialized_start=343
-  _globals['_DUMPSERVICE']._serialized_end=421
+  _globals['_DUMPREQUEST']._serialized_end=439
+  _globals['_DUMPREQUEST_METADATAENTRY']._serialized_start=298
+  _globals['_DUMPREQUEST_METADATAENTRY']._serialized_end=345
+  _globals['_DUMPREQUEST_DATAFORMAT']._serialized_start=347
+  _globals['_DUMPREQUEST_DATAFORMAT']._serialized_end=395
+  _globals['_DUMPREQUEST_COMPRESSION']._serialized_start=397
+  _globals['_DUMPREQUEST_COMPRESSION']._serialized_end=439
+  _globals['_DUMPCHUNK']._serialized_start=442
+  _globals['_DUMPCHUNK']._serialized_end=821
+  _globals['_DUMPCHUNK_METADATAENTRY']._serialized_start=774
+  _globals['_DUMPCHUNK_METADATAENTRY']._serialized_end=821
+  _globals['_UPLOADQUERY']._serialized_start=823
+  _globals['_UPLOADQUERY']._serialized_end=855
+  _globals['_UPLOADSTATUS']._serialized_start=857
+  _globals['_UPLOADSTATUS']._serialized_end=970
+  _globals['_BYTERANGE']._serialized_start=972
+  _globals['_BYTERANGE']._serialized_end=1011
+  _globals['_COMMITREQUEST']._serialized_start=1013
+  _globals['_COMMITREQUEST']._serialized_end=1102
+  _globals['_PROBEREQUEST']._serialized_start=1105
+  _globals['_PROBEREQUEST']._serialized_end=1329
+  _globals['_PROBEREQUEST_METADATAENTRY']._serialized_start=1282
+  _globals['_PROBEREQUEST_METADATAENTRY']._serialized_end=1329
+  _globals['_PROBERESPONSE']._serialized_start=1331
+  _globals['_PROBERESPONSE']._serialized_end=1380
+  _globals['_SHMDUMPREQUEST']._serialized_start=1383
+  _globals['_SHMDUMPREQUEST']._serialized_end=1630
+  _globals['_SHMDUMPREQUEST_METADATAENTRY']._serialized_start=1583
+  _globals['_SHMDUMPREQUEST_METADATAENTRY']._serialized_end=1630
+  _globals['_DUMPRESPONSE']._serialized_start=1633
+  _globals['_DUMPRESPONSE']._serialized_end=1761
+  _globals['_SESSIONDUMP']._serialized_start=1763
+  _globals['_SESSIONDUMP']._serialized_end=1829
+  _globals['_SESSIONFAILURE']._serialized_start=1831
+  _globals['_SESSIONFAILURE']._serialized_end=1877
+  _globals['_SESSIONACK']._serialized_start=1879
+  _globals['_SESSIONACK']._serialized_end=1993
+  _globals['_STATSREQUEST']._serialized_start=1995
+  _globals['_STATSREQUEST']._serialized_end=2009
+  _globals['_LATENCYBUCKET']._serialized_start=2011
+  _globals['_LATENCYBUCKET']._serialized_end=2059
+  _globals['_LATENCYHISTOGRAM']._serialized_start=2062
+  _globals['_LATENCYHISTOGRAM']._serialized_end=2252
+  _globals['_FORMATSTATS']._serialized_start=2255
+  _globals['_FORMATSTATS']._serialized_end=2561
+  _globals['_STATSRESPONSE']._serialized_start=2564
+  _globals['_STATSRESPONSE']._serialized_end=2793
+  _globals['_FLAMEGRAPHQUERY']._serialized_start=2796
+  _globals['_FLAMEGRAPHQUERY']._serialized_end=3028
+  _globals['_FLAMEGRAPHQUERY_STAGETYPE']._serialized_start=2956
+  _globals['_FLAMEGRAPHQUERY_STAGETYPE']._serialized_end=3028
+  _globals['_FLAMENODE']._serialized_start=3030
+  _globals['_FLAMENODE']._serialized_end=3085
+  _globals['_FLAMEGRAPHRESPONSE']._serialized_start=3088
+  _globals['_FLAMEGRAPHRESPONSE']._serialized_end=3233
+  _globals['_DUMPSERVICE']._serialized_start=3236
+  _globals['_DUMPSERVICE']._serialized_end=3878
 # @@protoc_insertion_point(module_scope)
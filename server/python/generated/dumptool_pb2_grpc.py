@@ -39,6 +39,46 @@ class DumpServiceStub(object):
                 request_serializer=dumptool__pb2.DumpRequest.SerializeToString,
                 response_deserializer=dumptool__pb2.DumpResponse.FromString,
                 _registered_method=True)
+        self.UploadDump = channel.stream_unary(
+                '/dumptool.v1.DumpService/UploadDump',
+                request_serializer=dumptool__pb2.DumpChunk.SerializeToString,
+                response_deserializer=dumptool__pb2.DumpResponse.FromString,
+                _registered_method=True)
+        self.QueryUpload = channel.unary_unary(
+                '/dumptool.v1.DumpService/QueryUpload',
+                request_serializer=dumptool__pb2.UploadQuery.SerializeToString,
+                response_deserializer=dumptool__pb2.UploadStatus.FromString,
+                _registered_method=True)
+        self.ProbeDump = channel.unary_unary(
+                '/dumptool.v1.DumpService/ProbeDump',
+                request_serializer=dumptool__pb2.ProbeRequest.SerializeToString,
+                response_deserializer=dumptool__pb2.ProbeResponse.FromString,
+                _registered_method=True)
+        self.SendShmDump = channel.unary_unary(
+                '/dumptool.v1.DumpService/SendShmDump',
+                request_serializer=dumptool__pb2.ShmDumpRequest.SerializeToString,
+                response_deserializer=dumptool__pb2.DumpResponse.FromString,
+                _registered_method=True)
+        self.CommitUpload = channel.unary_unary(
+                '/dumptool.v1.DumpService/CommitUpload',
+                request_serializer=dumptool__pb2.CommitRequest.SerializeToString,
+                response_deserializer=dumptool__pb2.DumpResponse.FromString,
+                _registered_method=True)
+        self.DumpSession = channel.stream_stream(
+                '/dumptool.v1.DumpService/DumpSession',
+                request_serializer=dumptool__pb2.SessionDump.SerializeToString,
+                response_deserializer=dumptool__pb2.SessionAck.FromString,
+                _registered_method=True)
+        self.GetStats = channel.unary_unary(
+                '/dumptool.v1.DumpService/GetStats',
+                request_serializer=dumptool__pb2.StatsRequest.SerializeToString,
+                response_deserializer=dumptool__pb2.StatsResponse.FromString,
+                _registered_method=True)
+        self.QueryFlamegraph = channel.unary_unary(
+                '/dumptool.v1.DumpService/QueryFlamegraph',
+                request_serializer=dumptool__pb2.FlamegraphQuery.SerializeToString,
+                response_deserializer=dumptool__pb2.FlamegraphResponse.FromString,
+                _registered_method=True)
 
 
 class DumpServiceServicer(object):
@@ -50,6 +90,54 @@ class DumpServiceServicer(object):
         context.set_details('Method not implemented!')
         raise NotImplementedError('Method not implemented!')
 
+    def UploadDump(self, request_iterator, context):
+        """Missing associated documentation comment in .proto file."""
+        context.set_code(grpc.StatusCode.UNIMPLEMENTED)
+        context.set_details('Method not implemented!')
+        raise NotImplementedError('Method not implemented!')
+
+    def QueryUpload(self, request, context):
+        """Missing associated documentation comment in .proto file."""
+        context.set_code(grpc.StatusCode.UNIMPLEMENTED)
+        context.set_details('Method not implemented!')
+        raise NotImplementedError('Method not implemented!')
+
+    def ProbeDump(self, request, context):
+        """Missing associated documentation comment in .proto file."""
+        context.set_code(grpc.StatusCode.UNIMPLEMENTED)
+        context.set_details('Method not implemented!')
+        raise NotImplementedError('Method not implemented!')
+
+    def SendShmDump(self, request, context):
+        """Missing associated documentation comment in .proto file."""
+        context.set_code(grpc.StatusCode.UNIMPLEMENTED)
+        context.set_details('Method not implemented!')
+        raise NotImplementedError('Method not implemented!')
+
+    def CommitUpload(self, request, context):
+        """Missing associated documentation comment in .proto file."""
+        context.set_code(grpc.StatusCode.UNIMPLEMENTED)
+        context.set_details('Method not implemented!')
+        raise NotImplementedError('Method not implemented!')
+
+    def DumpSession(self, request_iterator, context):
+        """Missing associated documentation comment in .proto file."""
+        context.set_code(grpc.StatusCode.UNIMPLEMENTED)
+        context.set_details('Method not implemented!')
+        raise NotImplementedError('Method not implemented!')
+
+    def GetStats(self, request, context):
+        """Missing associated documentation comment in .proto file."""
+        context.set_code(grpc.StatusCode.UNIMPLEMENTED)
+        context.set_details('Method not implemented!')
+        raise NotImplementedError('Method not implemented!')
+
+    def QueryFlamegraph(self, request, context):
+        """Missing associated documentation comment in .proto file."""
+        context.set_code(grpc.StatusCode.UNIMPLEMENTED)
+        context.set_details('Method not implemented!')
+        raise NotImplementedError('Method not implemented!')
+
 
 def add_DumpServiceServicer_to_server(servicer, server):
     rpc_method_handlers = {
@@ -58,6 +146,46 @@ def add_DumpServiceServicer_to_server(servicer, server):
                     request_deserializer=dumptool__pb2.DumpRequest.FromString,
                     response_serializer=dumptool__pb2.DumpResponse.SerializeToString,
             ),
+            'UploadDump': grpc.stream_unary_rpc_method_handler(
+                    servicer.UploadDump,
+                    request_deserializer=dumptool__pb2.DumpChunk.FromString,
+                    response_serializer=dumptool__pb2.DumpResponse.SerializeToString,
+            ),
+            'QueryUpload': grpc.unary_unary_rpc_method_handler(
+                    servicer.QueryUpload,
+                    request_deserializer=dumptool__pb2.UploadQuery.FromString,
+                    response_serializer=dumptool__pb2.UploadStatus.SerializeToString,
+            ),
+            'ProbeDump': grpc.unary_unary_rpc_method_handler(
+                    servicer.ProbeDump,
+                    request_deserializer=dumptool__pb2.ProbeRequest.FromString,
+                    response_serializer=dumptool__pb2.ProbeResponse.SerializeToString,
+            ),
+            'SendShmDump': grpc.unary_unary_rpc_method_handler(
+                    servicer.SendShmDump,
+                    request_deserializer=dumptool__pb2.ShmDumpRequest.FromString,
+                    response_serializer=dumptool__pb2.DumpResponse.SerializeToString,
+            ),
+            'CommitUpload': grpc.unary_unary_rpc_method_handler(
+                    servicer.CommitUpload,
+                    request_deserializer=dumptool__pb2.CommitRequest.FromString,
+                    response_serializer=dumptool__pb2.DumpResponse.SerializeToString,
+            ),
+            'DumpSession': grpc.stream_stream_rpc_method_handler(
+                    servicer.DumpSession,
+                    request_deserializer=dumptool__pb2.SessionDump.FromString,
+                    response_serializer=dumptool__pb2.SessionAck.SerializeToString,
+            ),
+            'GetStats': grpc.unary_unary_rpc_method_handler(
+                    servicer.GetStats,
+                    request_deserializer=dumptool__pb2.StatsRequest.FromString,
+                    response_serializer=dumptool__pb2.StatsResponse.SerializeToString,
+            ),
+            'QueryFlamegraph': grpc.unary_unary_rpc_method_handler(
+                    servicer.QueryFlamegraph,
+                    request_deserializer=dumptool__pb2.FlamegraphQuery.FromString,
+                    response_serializer=dumptool__pb2.FlamegraphResponse.SerializeToString,
+            ),
     }
     generic_handler = grpc.method_handlers_generic_handler(
             'dumptool.v1.DumpService', rpc_method_handlers)
@@ -95,3 +223,219 @@ class DumpService(object):
             timeout,
             metadata,
             _registered_method=True)
+
+    @staticmethod
+    def UploadDump(request_iterator,
+            target,
+            options=(),
+            channel_credentials=None,
+            call_credentials=None,
+            insecure=False,
+            compression=None,
+            wait_for_ready=None,
+            timeout=None,
+            metadata=None):
+        return grpc.experimental.stream_unary(
+            request_iterator,
+            target,
+            '/dumptool.v1.DumpService/UploadDump',
+            dumptool__pb2.DumpChunk.SerializeToString,
+            dumptool__pb2.DumpResponse.FromString,
+            options,
+            channel_credentials,
+            insecure,
+            call_credentials,
+            compression,
+            wait_for_ready,
+            timeout,
+            metadata,
+            _registered_method=True)
+
+    @staticmethod
+    def QueryUpload(request,
+            target,
+            options=(),
+            channel_credentials=None,
+            call_credentials=None,
+            insecure=False,
+            compression=None,
+            wait_for_ready=None,
+            timeout=None,
+            metadata=None):
+        return grpc.experimental.unary_unary(
+            request,
+            target,
+            '/dumptool.v1.DumpService/QueryUpload',
+            dumptool__pb2.UploadQuery.SerializeToString,
+            dumptool__pb2.UploadStatus.FromString,
+            options,
+            channel_credentials,
+            insecure,
+            call_credentials,
+            compression,
+            wait_for_ready,
+            timeout,
+            metadata,
+            _registered_method=True)
+
+    @staticmethod
+    def ProbeDump(request,
+            target,
+            options=(),
+            channel_credentials=None,
+            call_credentials=None,
+            insecure=False,
+            compression=None,
+            wait_for_ready=None,
+            timeout=None,
+            metadata=None):
+        return grpc.experimental.unary_unary(
+            request,
+            target,
+            '/dumptool.v1.DumpService/ProbeDump',
+            dumptool__pb2.ProbeRequest.SerializeToString,
+            dumptool__pb2.ProbeResponse.FromString,
+            options,
+            channel_credentials,
+            insecure,
+            call_credentials,
+            compression,
+            wait_for_ready,
+            timeout,
+            metadata,
+            _registered_method=True)
+
+    @staticmethod
+    def SendShmDump(request,
+            target,
+            options=(),
+            channel_credentials=None,
+            call_credentials=None,
+            insecure=False,
+            compression=None,
+            wait_for_ready=None,
+            timeout=None,
+            metadata=None):
+        return grpc.experimental.unary_unary(
+            request,
+            target,
+            '/dumptool.v1.DumpService/SendShmDump',
+            dumptool__pb2.ShmDumpRequest.SerializeToString,
+            dumptool__pb2.DumpResponse.FromString,
+            options,
+            channel_credentials,
+            insecure,
+            call_credentials,
+            compression,
+            wait_for_ready,
+            timeout,
+            metadata,
+            _registered_method=True)
+
+    @staticmethod
+    def CommitUpload(request,
+            target,
+            options=(),
+            channel_credentials=None,
+            call_credentials=None,
+            insecure=False,
+            compression=None,
+            wait_for_ready=None,
+            timeout=None,
+            metadata=None):
+        return grpc.experimental.unary_unary(
+            request,
+            target,
+            '/dumptool.v1.DumpService/CommitUpload',
+            dumptool__pb2.CommitRequest.SerializeToString,
+            dumptool__pb2.DumpResponse.FromString,
+            options,
+            channel_credentials,
+            insecure,
+            call_credentials,
+            compression,
+            wait_for_ready,
+            timeout,
+            metadata,
+            _registered_method=True)
+
+    @staticmethod
+    def DumpSession(request_iterator,
+            target,
+            options=(),
+            channel_credentials=None,
+            call_credentials=None,
+            insecure=False,
+            compression=None,
+            wait_for_ready=None,
+            timeout=None,
+            metadata=None):
+        return grpc.experimental.stream_stream(
+            request_iterator,
+            target,
+            '/dumptool.v1.DumpService/DumpSession',
+            dumptool__pb2.SessionDump.SerializeToString,
+            dumptool__pb2.SessionAck.FromString,
+            options,
+            channel_credentials,
+            insecure,
+            call_credentials,
+            compression,
+            wait_for_ready,
+            timeout,
+            metadata,
+            _registered_method=True)
+
+    @staticmethod
+    def GetStats(request,
+            target,
+            options=(),
+            channel_credentials=None,
+            call_credentials=None,
+            insecure=False,
+            compression=None,
+            wait_for_ready=None,
+            timeout=None,
+            metadata=None):
+        return grpc.experimental.unary_unary(
+            request,
+            target,
+            '/dumptool.v1.DumpService/GetStats',
+            dumptool__pb2.StatsRequest.SerializeToString,
+            dumptool__pb2.StatsResponse.FromString,
+            options,
+            channel_credentials,
+            insecure,
+            call_credentials,
+            compression,
+            wait_for_ready,
+            timeout,
+            metadata,
+            _registered_method=True)
+
+    @staticmethod
+    def QueryFlamegraph(request,
+            target,
+            options=(),
+            channel_credentials=None,
+            call_credentials=None,
+            insecure=False,
+            compression=None,
+            wait_for_ready=None,
+            timeout=None,
+            metadata=None):
+        return grpc.experimental.unary_unary(
+            request,
+            target,
+            '/dumptool.v1.DumpService/QueryFlamegraph',
+            dumptool__pb2.FlamegraphQuery.SerializeToString,
+            dumptool__pb2.FlamegraphResponse.FromString,
+            options,
+            channel_credentials,
+            insecure,
+            call_credentials,
+            compression,
+            wait_for_ready,
+            timeout,
+            metadata,
+            _registered_method=True)
@@ -0,0 +1,88 @@
+from generated import dumptool_pb2
+
+try:
+    import lz4.frame
+except ImportError:
+    lz4 = None
+
+try:
+    import zstandard
+except ImportError:
+    zstandard = None
+
+DumpRequest = dumptool_pb2.DumpRequest
+
+
+class UnsupportedCompression(ValueError):
+    """本服务端缺少对应的解压模块或不认识该算法, 客户端可改为不压缩重发"""
+
+
+def supported():
+    """本服务端可以解压的算法"""
+    codecs = [DumpRequest.NONE]
+    if lz4 is not None:
+        codecs.append(DumpRequest.LZ4)
+    if zstandard is not None:
+        codecs.append(DumpRequest.ZSTD)
+    return codecs
+
+
+def decompress(compression, data, raw_size, max_size=None):
+    """
+    解压一个独立的压缩帧. raw_size 未知时传 None, 此时输出以 max_size 为上限 (分块上传时为
+    剩余可写入的字节数); 解压结果不会超过上限, 声明过大的帧在分配内存之前即被拒绝
+    """
+    if compression == DumpRequest.NONE:
+        return data
+    limit = raw_size if raw_size is not None else max_size
+    if compression == DumpRequest.LZ4:
+        if lz4 is None:
+            raise UnsupportedCompression("lz4 compression not supported: python lz4 module missing")
+        decode = lambda d: decompress_lz4(d, limit)
+    elif compression == DumpRequest.ZSTD:
+        if zstandard is None:
+            raise UnsupportedCompression(
+                "zstd compression not supported: python zstandard module missing")
+        decode = lambda d: decompress_zstd(d, limit)
+    else:
+        raise UnsupportedCompression(f"unknown compression {compression}")
+    try:
+        out = decode(data)
+    except ValueError:
+        raise
+    except Exception as e:
+        raise ValueError(f"{name(compression)} decompression failed: {e}") from e
+    if raw_size is not None and len(out) != raw_size:
+        raise ValueError(f"decompressed {len(out)} bytes, expected {raw_size}")
+    return out
+
+
+def decompress_lz4(data, limit):
+    if limit is None:
+        return lz4.frame.decompress(data)
+    decoder = lz4.frame.LZ4FrameDecompressor()
+    # 多取一个字节, 用来区分恰好等于上限和超出上限
+    out = decoder.decompress(data, max_length=limit + 1)
+    if len(out) > limit:
+        raise ValueError(f"LZ4 frame exceeds {limit} bytes")
+    if not decoder.eof:
+        raise ValueError("LZ4 decompression failed: truncated frame")
+    return out
+
+
+def decompress_zstd(data, limit):
+    if limit is None:
+        return zstandard.ZstdDecompressor().decompress(data)
+    # 帧头带有内容大小时 zstandard 按它分配内存而忽略 max_output_size, 需先检查
+    content_size = zstandard.frame_content_size(data)
+    if content_size > limit:
+        raise ValueError(f"ZSTD frame declares {content_size} bytes, limit {limit}")
+    # max_output_size=0 表示不限制, 上限为 0 时放宽到 1 字节, 由调用方校验长度
+    out = zstandard.ZstdDecompressor().decompress(data, max_output_size=max(limit, 1))
+    if len(out) > limit:
+        raise ValueError(f"ZSTD frame exceeds {limit} bytes")
+    return out
+
+
+def name(compression):
+    return DumpRequest.Compression.Name(compression)
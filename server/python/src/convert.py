@@ -0,0 +1,184 @@
+import collections
+import json
+import os
+import subprocess
+import sys
+import threading
+import time
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), "..", "..", ".."))
+INDEX_NAME = "index.jsonl"
+CONVERT_TIMEOUT = 600
+
+# (DataFormat, metadata 中的 type) -> 产物类型; metadata convert=none 可关闭单个 dump 的转换
+CONVERTERS = {
+    ("PROTOBUF", "mem"): "flamegraph",
+    ("PROTOBUF", "timeline"): "chrome",
+}
+
+
+def converter_for(format_name, metadata):
+    if metadata.get("convert") == "none":
+        return None
+    return CONVERTERS.get((format_name, metadata.get("type", "")))
+
+
+class ConvertQueue:
+    """
+    入库后的异步转换: 按 (dump_path, 产物类型) 去重排队, 排队数达到 max_jobs 时丢弃新任务,
+    不阻塞写入. 超过 large_bytes 的任务只交给一半的工作线程, 另一半只处理小任务,
+    大任务不会占满全部线程. 每个任务在子进程中运行转换脚本, 产物位置记入 .artifacts/index.jsonl.
+    """
+
+    def __init__(self, store, workers, max_jobs, large_bytes):
+        self.store = store
+        self.max_jobs = max_jobs
+        self.large_bytes = large_bytes
+        self.cond = threading.Condition()
+        self.small = collections.deque()
+        self.large = collections.deque()
+        self.pending = set()  # 排队中的 (dump_path, 产物类型)
+        self.closed = False
+        self.converted = self.failed = self.dropped = 0
+        os.makedirs(store.artifact_dir, exist_ok=True)
+        self.index_path = os.path.join(store.artifact_dir, INDEX_NAME)
+        small_only = workers // 2 if workers > 1 else 0
+        self.threads = [threading.Thread(target=self._work, args=(i >= small_only,),
+                                         name=f"convert-{i}", daemon=True)
+                        for i in range(workers)]
+        for thread in self.threads:
+            thread.start()
+
+    def submit(self, dump_path, format_name, metadata, size):
+        """dump 写入后调用, 可在任意线程中调用; 返回是否已排队"""
+        kind = converter_for(format_name, metadata)
+        if kind is None:
+            return False
+        key = (dump_path, kind)
+        with self.cond:
+            # 同一 dump 已在排队时不再重复, 任务执行时读取的是最新内容
+            if key in self.pending:
+                return True
+            if len(self.pending) >= self.max_jobs:
+                self.dropped += 1
+                print(f"[Convert] Queue full, skipped {dump_path} -> {kind}")
+                return False
+            self.pending.add(key)
+            (self.large if size > self.large_bytes else self.small).append(key)
+            self.cond.notify_all()
+        return True
+
+    def close(self):
+        with self.cond:
+            self.closed = True
+            self.cond.notify_all()
+
+    def artifacts(self, dump_path):
+        """返回 {产物类型: 相对存储根目录的路径}, 同一类型取最新一次转换"""
+        key = os.path.relpath(self.store.resolve(dump_path), self.store.root)
+        found = {}
+        try:
+            with open(self.index_path) as f:
+                for line in f:
+                    entry = json.loads(line)
+                    if entry["path"] == key:
+                        found[entry["kind"]] = entry["artifact"]
+        except FileNotFoundError:
+            pass
+        return found
+
+    def _work(self, takes_large):
+        while True:
+            with self.cond:
+                while not self.closed and not self.small and not (takes_large and self.large):
+                    self.cond.wait()
+                if self.closed:
+                    return
+                queue = self.large if takes_large and self.large else self.small
+                key = queue.popleft()
+                self.pending.discard(key)
+            self._convert(*key)
+
+    def _convert(self, dump_path, kind):
+        start = time.monotonic()
+        output = tmp = None
+        try:
+            data = self.store.read(dump_path)
+            key = os.path.relpath(self.store.resolve(dump_path), self.store.root)
+            output = os.path.join(self.store.artifact_dir, f"{key}@{kind}.json")
+            os.makedirs(os.path.dirname(output), exist_ok=True)
+            tmp = f"{output}.{os.getpid()}.{threading.get_ident()}.tmp"
+            # 各转换脚本的 protobuf 定义有同名的顶层消息, 不能加载到同一进程
+            subprocess.run([sys.executable, os.path.abspath(__file__), kind, tmp], input=data,
+                           stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+                           timeout=CONVERT_TIMEOUT, check=True)
+            os.replace(tmp, output)
+        except subprocess.CalledProcessError as e:
+            lines = e.stderr.decode(errors="replace").strip().splitlines()
+            self._failed(dump_path, kind, lines[-1] if lines else e, tmp)
+            return
+        except (ValueError, OSError, subprocess.SubprocessError) as e:
+            self._failed(dump_path, kind, e, tmp)
+            return
+        artifact = os.path.relpath(output, self.store.root)
+        entry = {"path": key, "kind": kind, "artifact": artifact, "ts": time.time_ns(),
+                 "size": len(data)}
+        # 一行一次 O_APPEND 写入, 多个工作进程共用同一索引
+        fd = os.open(self.index_path, os.O_WRONLY | os.O_CREAT | os.O_APPEND, 0o644)
+        try:
+            os.write(fd, (json.dumps(entry, separators=(",", ":")) + "\n").encode())
+        finally:
+            os.close(fd)
+        with self.cond:
+            self.converted += 1
+        print(f"[Convert] {dump_path} -> {artifact} "
+              f"({int((time.monotonic() - start) * 1000)} ms)")
+
+    def _failed(self, dump_path, kind, error, tmp):
+        with self.cond:
+            self.failed += 1
+        print(f"[Convert] {dump_path} -> {kind} failed: {error}")
+        if tmp:
+            try:
+                os.unlink(tmp)
+            except FileNotFoundError:
+                pass
+
+
+def convert_flamegraph(data, output):
+    sys.path.insert(0, os.path.join(ROOT, "converttool", "flamegraph"))
+    from convert_bin_to_flamegraph_final_final import ProcMemConverter
+    from mem_profile_pb2 import Mem
+
+    mem = Mem()
+    mem.ParseFromString(data)
+    converter = ProcMemConverter()
+    events = []
+    for proc_mem in mem.proc_mem:
+        events.extend(converter._generate_flamegraph_events(
+            converter._analyze_allocations(proc_mem)))
+    converter._save_json(output, events)
+
+
+def convert_chrome(data, output):
+    sys.path.insert(0, os.path.join(ROOT, "prototest", "timeline", "test"))
+    import convert_to_chrome_json as chrome
+
+    timeline = chrome.timeline_pb2.Timeline()
+    timeline.ParseFromString(data)
+    with open(output, "w") as f:
+        json.dump(chrome.convert_to_chrome_json(timeline), f, indent=2)
+
+
+def main():
+    # 转换子进程: payload 从 stdin 读入, 产物写到 argv[2]
+    if len(sys.argv) != 3:
+        print("Usage: python3 convert.py flamegraph|chrome OUTPUT < dump", file=sys.stderr)
+        sys.exit(2)
+    kind, output = sys.argv[1:]
+    convert = {"flamegraph": convert_flamegraph, "chrome": convert_chrome}[kind]
+    convert(sys.stdin.buffer.read(), output)
+
+
+if __name__ == "__main__":
+    main()
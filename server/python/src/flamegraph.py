@@ -0,0 +1,269 @@
+import argparse
+import collections
+import heapq
+import json
+import os
+import sys
+import threading
+import time
+
+from google.protobuf.message import DecodeError
+
+from generated import dumptool_pb2
+from convert import ROOT
+
+CATALOG_NAME = "mem.jsonl"
+DEFAULT_MAX_NODES = 2000
+STAGE_NAMES = {0: "DATA_LOAD", 1: "FORWARD", 2: "BACKWARD"}  # 与火焰图转换脚本一致
+
+
+class FlamegraphIndex:
+    """
+    服务端合并内存火焰图: 入库时 (含分条上传提交与去重链接) 把 type=mem 且带 job 的 dump
+    记入 .artifacts/mem.jsonl, 查询时按 job / rank / step 选出 dump, 合并各自的调用树并按节点预算裁剪.
+    单个 dump 的调用树和查询结果都有 LRU 缓存, 重复查询不再读取 dump.
+    """
+
+    def __init__(self, store, cache_dumps=64, cache_queries=32):
+        self.store = store
+        self.lock = threading.Lock()
+        os.makedirs(store.artifact_dir, exist_ok=True)
+        self.catalog_path = os.path.join(store.artifact_dir, CATALOG_NAME)
+        self.scanned = 0
+        self.dumps = {}  # dump 相对路径 -> (job, rank, step, ts), 同一路径取最新
+        self.trees = collections.OrderedDict()    # (路径, ts) -> {stage_type: 调用树}
+        self.results = collections.OrderedDict()  # (查询, 选中的 dump) -> FlamegraphResponse
+        self.cache_dumps = cache_dumps
+        self.cache_queries = cache_queries
+
+    def record(self, dump_path, metadata):
+        """dump 写入、分条提交或去重链接后由 DumpService._stored 调用, 可在任意线程中调用"""
+        if metadata.get("type") != "mem" or not metadata.get("job"):
+            return
+        entry = {"path": os.path.relpath(self.store.resolve(dump_path), self.store.root),
+                 "job": metadata["job"], "rank": parse_int(metadata.get("rank")),
+                 "step": parse_int(metadata.get("step")), "ts": time.time_ns()}
+        # 一行一次 O_APPEND 写入, 多个工作进程共用
+        fd = os.open(self.catalog_path, os.O_WRONLY | os.O_CREAT | os.O_APPEND, 0o644)
+        try:
+            os.write(fd, (json.dumps(entry, separators=(",", ":")) + "\n").encode())
+        finally:
+            os.close(fd)
+
+    def query(self, request):
+        with self.lock:
+            self._refresh()
+            selected = sorted((path, ts) for path, (job, rank, step, ts) in self.dumps.items()
+                              if job == request.job and selected_dump(request, rank, step))
+            key = (request.SerializeToString(deterministic=True), tuple(selected))
+            cached = self.results.get(key)
+            if cached is not None:
+                self.results.move_to_end(key)
+                response = dumptool_pb2.FlamegraphResponse()
+                response.CopyFrom(cached)
+                response.cached = True
+                return response
+
+        stages = set(request.stages)
+        root = [0, {}]
+        skipped = []
+        for path, ts in selected:
+            # 单个 dump 损坏或已删除时跳过, 不影响整个查询
+            try:
+                trees = self._tree(path, ts)
+            except (OSError, ValueError, DecodeError) as e:
+                skipped.append(f"{path}: {e}")
+                continue
+            for stage_type, tree in trees.items():
+                if not stages or stage_type in stages:
+                    merge(root, STAGE_NAMES.get(stage_type, f"STAGE_{stage_type}"), tree)
+        response = prune(root, request.max_nodes or DEFAULT_MAX_NODES)
+        response.success = True
+        response.dumps = len(selected) - len(skipped)
+        response.message = f"merged {response.dumps} dumps"
+        if skipped:
+            response.message += f", skipped {len(skipped)} ({skipped[0]})"
+
+        with self.lock:
+            self.results[key] = response
+            while len(self.results) > self.cache_queries:
+                self.results.popitem(last=False)
+        return response
+
+    def _tree(self, path, ts):
+        key = (path, ts)
+        with self.lock:
+            tree = self.trees.get(key)
+            if tree is not None:
+                self.trees.move_to_end(key)
+                return tree
+        # 解析在锁外进行, 并发查询可以同时构建不同 dump 的调用树
+        tree = build_tree(self.store.read(path))
+        with self.lock:
+            self.trees[key] = tree
+            while len(self.trees) > self.cache_dumps:
+                self.trees.popitem(last=False)
+        return tree
+
+    def _refresh(self):
+        """读入目录新增的完整行, 其他工作进程登记的 dump 也由此可见"""
+        try:
+            if os.stat(self.catalog_path).st_size <= self.scanned:
+                return
+            with open(self.catalog_path, "rb") as f:
+                f.seek(self.scanned)
+                data = f.read()
+        except FileNotFoundError:
+            return
+        end = data.rfind(b"\n") + 1
+        for line in data[:end].splitlines():
+            entry = json.loads(line)
+            current = self.dumps.get(entry["path"])
+            if current is None or current[3] <= entry["ts"]:
+                self.dumps[entry["path"]] = (entry["job"], entry["rank"], entry["step"],
+                                             entry["ts"])
+        self.scanned += end
+
+
+def parse_int(value):
+    try:
+        return int(value)
+    except (TypeError, ValueError):
+        return None
+
+
+def selected_dump(request, rank, step):
+    if request.ranks and rank not in request.ranks:
+        return False
+    if request.step_begin or request.step_end:
+        end = request.step_end or float("inf")
+        return step is not None and request.step_begin <= step <= end
+    return True
+
+
+def build_tree(data):
+    """
+    解析 Mem, 丢弃已释放的分配, 按阶段合并调用栈. 节点为 [size, {帧名: 子节点}],
+    size 为包含子孙的总量; 帧名与火焰图转换脚本相同 (so_name@地址).
+    """
+    converters = os.path.join(ROOT, "converttool", "flamegraph")
+    if converters not in sys.path:
+        sys.path.insert(0, converters)
+    from mem_profile_pb2 import Mem
+
+    mem = Mem()
+    mem.ParseFromString(data)
+    stages = {}
+    for proc_mem in mem.proc_mem:
+        freed = {free.alloc_ptr for free in proc_mem.mem_free_stacks}
+        for alloc in proc_mem.mem_alloc_stacks:
+            if alloc.alloc_ptr in freed:
+                continue
+            node = stages.setdefault(alloc.stage_type, [0, {}])
+            node[0] += alloc.mem_size
+            for frame in alloc.stack_frames:
+                name = f"{frame.so_name}@{hex(frame.address)}"
+                child = node[1].get(name)
+                if child is None:
+                    child = node[1][name] = [0, {}]
+                child[0] += alloc.mem_size
+                node = child
+    return stages
+
+
+def merge(parent, name, tree):
+    """把 tree 累加到 parent 的 name 子节点下, 不修改缓存中的 tree"""
+    parent[0] += tree[0]
+    stack = [(parent[1], name, tree)]
+    while stack:
+        children, name, node = stack.pop()
+        target = children.get(name)
+        if target is None:
+            target = children[name] = [0, {}]
+        target[0] += node[0]
+        for child_name, child in node[1].items():
+            stack.append((target[1], child_name, child))
+
+
+def prune(root, max_nodes):
+    """从根开始每次展开 size 最大的节点, 直到达到 max_nodes"""
+    response = dumptool_pb2.FlamegraphResponse()
+    response.nodes.add(name="all", size=root[0], parent=0)
+    total = 1
+    heap = []
+    seq = 0
+    for name, child in root[1].items():
+        heap.append((-child[0], seq, name, child, 0))
+        seq += 1
+    heapq.heapify(heap)
+    while heap and len(response.nodes) < max_nodes:
+        _, _, name, node, parent = heapq.heappop(heap)
+        index = len(response.nodes)
+        response.nodes.add(name=name, size=node[0], parent=parent)
+        for child_name, child in node[1].items():
+            heapq.heappush(heap, (-child[0], seq, child_name, child, index))
+            seq += 1
+    # 统计裁剪前的总节点数
+    stack = [root]
+    while stack:
+        node = stack.pop()
+        total += len(node[1])
+        stack.extend(node[1].values())
+    response.total_nodes = total
+    return response
+
+
+def folded(response):
+    """按 flamegraph.pl 的折叠格式输出, 每行为一条路径及其自身大小"""
+    nodes = response.nodes
+    paths = [""] * len(nodes)
+    own = [node.size for node in nodes]
+    for i, node in enumerate(nodes):
+        if i == 0:
+            continue
+        paths[i] = f"{paths[node.parent]};{node.name}" if node.parent else node.name
+        own[node.parent] -= node.size
+    return "".join(f"{paths[i]} {own[i]}\n" for i in range(1, len(nodes)) if own[i] > 0)
+
+
+def main():
+    import grpc
+    from generated import dumptool_pb2_grpc
+
+    parser = argparse.ArgumentParser(description="query a merged memory flamegraph")
+    parser.add_argument("--server", default="localhost:50051")
+    parser.add_argument("--job", required=True)
+    parser.add_argument("--ranks", default="", help="comma separated, default all")
+    parser.add_argument("--stages", default="",
+                        help="comma separated DATALOADER,FORWARD,BACKWARD, default all")
+    parser.add_argument("--steps", default="", help="BEGIN-END (inclusive), default all")
+    parser.add_argument("--max-nodes", type=int, default=0)
+    parser.add_argument("--json", action="store_true",
+                        help="print the node list instead of folded stacks")
+    args = parser.parse_args()
+
+    request = dumptool_pb2.FlamegraphQuery(job=args.job, max_nodes=args.max_nodes)
+    request.ranks.extend(int(rank) for rank in args.ranks.split(",") if rank)
+    for stage in filter(None, args.stages.split(",")):
+        request.stages.append(dumptool_pb2.FlamegraphQuery.StageType.Value(
+            "STAGE_" + stage.upper()))
+    if args.steps:
+        begin, _, end = args.steps.partition("-")
+        request.step_begin, request.step_end = int(begin), int(end or begin)
+
+    with grpc.insecure_channel(args.server) as channel:
+        response = dumptool_pb2_grpc.DumpServiceStub(channel).QueryFlamegraph(request)
+    if not response.success:
+        print(response.message, file=sys.stderr)
+        sys.exit(1)
+    print(f"{response.dumps} dumps, {len(response.nodes)} of {response.total_nodes} nodes"
+          + (" (cached)" if response.cached else ""), file=sys.stderr)
+    if args.json:
+        json.dump([{"name": n.name, "size": n.size, "parent": n.parent}
+                   for n in response.nodes], sys.stdout)
+    else:
+        sys.stdout.write(folded(response))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,229 @@
+import asyncio
+import os
+import time
+
+from generated import dumptool_pb2
+
+STAGES = ("queue", "decode", "write", "fsync", "total")
+SUB_BUCKETS = 32
+HALF = SUB_BUCKETS // 2
+RATE_WINDOW = 60  # 速率按最近 60 秒统计
+QUANTILES = ((0.5, "p50_us"), (0.9, "p90_us"), (0.99, "p99_us"), (0.999, "p999_us"))
+
+
+class Histogram:
+    """
+    HDR 风格的对数线性直方图, 单位微秒: 小于 32 的值逐一计数, 之后每个 2 的幂区间分 16 档.
+    只保存非空的桶, 记录是 O(1) 的.
+    """
+
+    def __init__(self):
+        self.counts = {}
+        self.count = 0
+        self.sum = 0
+        self.max = 0
+
+    def record(self, value):
+        value = max(0, int(value))
+        index = bucket_index(value)
+        self.counts[index] = self.counts.get(index, 0) + 1
+        self.count += 1
+        self.sum += value
+        self.max = max(self.max, value)
+
+    def percentile(self, p):
+        target = max(1, int(p * self.count + 0.999999))
+        seen = 0
+        for index in sorted(self.counts):
+            seen += self.counts[index]
+            if seen >= target:
+                return min(bucket_upper(index), self.max)
+        return self.max
+
+    def to_proto(self, stage):
+        hist = dumptool_pb2.LatencyHistogram(stage=stage, count=self.count, sum_us=self.sum,
+                                             max_us=self.max)
+        if self.count:
+            for p, field in QUANTILES:
+                setattr(hist, field, self.percentile(p))
+        for index in sorted(self.counts):
+            hist.buckets.add(upper_us=bucket_upper(index), count=self.counts[index])
+        return hist
+
+
+def bucket_index(value):
+    if value < SUB_BUCKETS:
+        return value
+    shift = value.bit_length() - 5
+    return SUB_BUCKETS + (shift - 1) * HALF + (value >> shift) - HALF
+
+
+def bucket_upper(index):
+    if index < SUB_BUCKETS:
+        return index
+    shift, sub = divmod(index - SUB_BUCKETS, HALF)
+    shift += 1
+    return ((sub + HALF + 1) << shift) - 1
+
+
+class Trace:
+    """一次 SendDump 的耗时, 写入线程填写 started/decode/write, 其余由处理协程填写"""
+
+    __slots__ = ("format", "received", "started", "decode", "write", "fsync", "raw_size",
+                 "busy")
+
+    def __init__(self, format):
+        self.format = format
+        self.received = time.monotonic()
+        self.started = None
+        self.decode = self.write = self.fsync = None
+        self.raw_size = 0
+        self.busy = False
+
+
+class FormatStats:
+    def __init__(self):
+        self.requests = self.failures = self.busy = 0
+        self.bytes_in = self.raw_bytes = 0
+        self.inflight = self.max_inflight = self.queued = 0
+        self.latency = {stage: Histogram() for stage in STAGES}
+        self.window = [[0, 0, 0] for _ in range(RATE_WINDOW)]  # [秒, 请求数, 字节数]
+
+    def count_rate(self, now, size):
+        second = int(now)
+        slot = self.window[second % RATE_WINDOW]
+        if slot[0] != second:
+            slot[:] = [second, 0, 0]
+        slot[1] += 1
+        slot[2] += size
+
+    def rate(self, now, uptime):
+        second = int(now)
+        requests = size = 0
+        for start, n, nbytes in self.window:
+            if second - RATE_WINDOW < start <= second:
+                requests += n
+                size += nbytes
+        span = max(1.0, min(RATE_WINDOW, uptime))
+        return requests / span, size / span
+
+
+class IngestStats:
+    """
+    按 DataFormat 汇总的 SendDump 统计. 只在事件循环线程中更新, 不需要加锁;
+    写入线程测得的耗时记在 Trace 里, 请求结束时一并汇总.
+    """
+
+    def __init__(self):
+        self.start = time.monotonic()
+        self.formats = {}
+
+    def _format(self, format):
+        stats = self.formats.get(format)
+        if stats is None:
+            stats = self.formats[format] = FormatStats()
+        return stats
+
+    def begin(self, request):
+        trace = Trace(request.format)
+        stats = self._format(request.format)
+        stats.inflight += 1
+        stats.max_inflight = max(stats.max_inflight, stats.inflight)
+        stats.bytes_in += len(request.payload)
+        stats.count_rate(trace.received, len(request.payload))
+        return trace
+
+    def enqueued(self, trace):
+        self._format(trace.format).queued += 1
+
+    def dequeued(self, trace):
+        self._format(trace.format).queued -= 1
+
+    def end(self, trace, response):
+        stats = self._format(trace.format)
+        stats.inflight -= 1
+        stats.requests += 1
+        if trace.busy:
+            stats.busy += 1
+            return
+        if response is None or not response.success:
+            stats.failures += 1
+            return
+        stats.raw_bytes += trace.raw_size
+        latency = stats.latency
+        if trace.started is not None:
+            latency["queue"].record((trace.started - trace.received) * 1e6)
+        if trace.decode is not None:
+            latency["decode"].record(trace.decode * 1e6)
+        if trace.write is not None:
+            latency["write"].record(trace.write * 1e6)
+        if trace.fsync is not None:
+            latency["fsync"].record(trace.fsync * 1e6)
+        latency["total"].record((time.monotonic() - trace.received) * 1e6)
+
+    def to_proto(self, ingest, commit=None):
+        now = time.monotonic()
+        uptime = now - self.start
+        response = dumptool_pb2.StatsResponse(pid=os.getpid(), uptime_sec=uptime,
+                                              queue_jobs=ingest.jobs,
+                                              queue_bytes=ingest.queued_bytes)
+        if commit:
+            response.syncs = commit.syncs
+            response.synced_dumps = commit.dumps
+        for format, stats in sorted(self.formats.items()):
+            rate, byte_rate = stats.rate(now, uptime)
+            entry = response.formats.add(
+                format=format, requests=stats.requests, failures=stats.failures,
+                busy=stats.busy, bytes_in=stats.bytes_in, raw_bytes=stats.raw_bytes,
+                requests_per_sec=rate, bytes_per_sec=byte_rate, inflight=stats.inflight,
+                max_inflight=stats.max_inflight, queued=stats.queued)
+            for stage in STAGES:
+                if stats.latency[stage].count:
+                    entry.latency.append(stats.latency[stage].to_proto(stage))
+        return response
+
+
+def render_text(response):
+    """按 Prometheus 文本格式输出 StatsResponse"""
+    lines = [
+        f"dumptool_uptime_seconds {response.uptime_sec:.3f}",
+        f"dumptool_queue_jobs {response.queue_jobs}",
+        f"dumptool_queue_bytes {response.queue_bytes}",
+        f"dumptool_fsync_total {response.syncs}",
+        f"dumptool_fsync_dumps_total {response.synced_dumps}",
+    ]
+    for entry in response.formats:
+        label = f'format="{dumptool_pb2.DumpRequest.DataFormat.Name(entry.format)}"'
+        for name in ("requests", "failures", "busy", "bytes_in", "raw_bytes"):
+            lines.append(f"dumptool_{name}_total{{{label}}} {getattr(entry, name)}")
+        for name in ("requests_per_sec", "bytes_per_sec"):
+            lines.append(f"dumptool_{name}{{{label}}} {getattr(entry, name):.3f}")
+        for name in ("inflight", "max_inflight", "queued"):
+            lines.append(f"dumptool_{name}{{{label}}} {getattr(entry, name)}")
+        for hist in entry.latency:
+            stage = f'{label},stage="{hist.stage}"'
+            for p, field in QUANTILES:
+                lines.append(f'dumptool_latency_us{{{stage},quantile="{p}"}} '
+                             f"{getattr(hist, field)}")
+            lines.append(f"dumptool_latency_us_sum{{{stage}}} {hist.sum_us}")
+            lines.append(f"dumptool_latency_us_count{{{stage}}} {hist.count}")
+            lines.append(f"dumptool_latency_us_max{{{stage}}} {hist.max_us}")
+    return "\n".join(lines) + "\n"
+
+
+async def serve_text(host, port, snapshot):
+    """本地文本端点: 对任意 HTTP 请求返回 snapshot() 的文本格式"""
+    async def handle(reader, writer):
+        try:
+            while (await reader.readline()).strip():
+                pass  # 丢弃请求行与请求头
+            body = render_text(snapshot()).encode()
+            writer.write(b"HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                         b"Content-Length: " + str(len(body)).encode() + b"\r\n\r\n" + body)
+            await writer.drain()
+        except ConnectionError:
+            pass
+        finally:
+            writer.close()
+
+    return await asyncio.start_server(handle, host, port)
@@ -0,0 +1,210 @@
+import argparse
+import json
+import os
+import sys
+import threading
+import time
+
+from storage import DumpStore, fsync_path
+
+SEGMENT_DIR = ".segments"
+DEFAULT_SEGMENT_BYTES = 256 * 1024 * 1024
+
+
+class Segment:
+    """正在追加的段: <name>.seg 只存 payload, <name>.idx 每行记录一个 dump 的位置"""
+
+    def __init__(self, segment_dir):
+        # 每个进程写自己的段, 名字带 pid, 进程间追加互不干扰
+        self.name = f"{time.time_ns():016x}-{os.getpid()}"
+        base = os.path.join(segment_dir, self.name)
+        self.fd = os.open(base + ".seg", os.O_WRONLY | os.O_CREAT | os.O_EXCL | os.O_APPEND,
+                          0o644)
+        self.index = open(base + ".idx", "a")
+        self.size = 0
+
+    def append(self, payload):
+        offset = self.size
+        view = memoryview(payload)
+        while view:
+            n = os.write(self.fd, view)
+            view = view[n:]
+        self.size += len(payload)
+        return offset
+
+    def close(self):
+        os.close(self.fd)
+        self.index.close()
+
+
+class SegmentStore(DumpStore):
+    """
+    整块到达的 dump 追加到 .segments 下的大段文件, 不再每个 dump 一个文件.
+    索引记录 (dump_path, metadata, 时间戳) -> (段, offset, length), 读取时一次 pread 取回;
+    段超过 segment_bytes 后换新段. 分块上传, 分条上传和去重链接仍按文件存储,
+    提交后在索引中记一条不带段的记录, 同一路径以时间戳最新的一条为准.
+    """
+
+    def __init__(self, root, segment_bytes=DEFAULT_SEGMENT_BYTES):
+        super().__init__(root)
+        self.segment_dir = os.path.join(self.root, SEGMENT_DIR)
+        os.makedirs(self.segment_dir, exist_ok=True)
+        self.segment_bytes = segment_bytes
+        self.lock = threading.Lock()
+        self.active = None
+        self.index = {}    # dump_path -> (段名, offset, length, ts, metadata), 同一路径取最新; 文件形式段名为 None
+        self.scanned = {}  # 索引文件 -> 已读入的字节数
+        self.dirty = set()  # 上次 sync 之后追加过的段
+
+    def resolve(self, dump_path):
+        path = super().resolve(dump_path)
+        if path == self.segment_dir or path.startswith(self.segment_dir + os.sep):
+            raise ValueError(f"invalid dump_path: {dump_path!r}")
+        return path
+
+    def write(self, dump_path, payload, metadata=None):
+        path = self.resolve(dump_path)
+        key = os.path.relpath(path, self.root)
+        entry = {"path": key, "ts": time.time_ns(), "metadata": dict(metadata or {})}
+        with self.lock:
+            segment = self._segment(len(payload))
+            entry["offset"] = segment.append(payload)
+            entry["length"] = len(payload)
+            # 先写数据后写索引, 崩溃时最多留下无索引的尾部数据
+            self._append_entry(segment, entry)
+        return path
+
+    def open_upload(self, dump_path, upload_id="", total_size=0, metadata=None):
+        upload = super().open_upload(dump_path, upload_id, total_size)
+        upload.on_commit = lambda path: self._record_file(path, metadata)
+        return upload
+
+    def commit_stripes(self, dump_path, upload_id, total_size, digest):
+        stored = super().commit_stripes(dump_path, upload_id, total_size, digest)
+        if stored is not None:
+            self._record_file(self.resolve(dump_path), stored[1])
+        return stored
+
+    def link_existing(self, dump_path, digest, size, metadata=None):
+        linked = super().link_existing(dump_path, digest, size)
+        if linked:
+            self._record_file(self.resolve(dump_path), metadata)
+        return linked
+
+    def _record_file(self, path, metadata):
+        """文件形式写入完成后登记, 之前写入段中的同一路径从此失效"""
+        entry = {"path": os.path.relpath(path, self.root), "ts": time.time_ns(),
+                 "metadata": dict(metadata or {}), "file": True}
+        with self.lock:
+            self._append_entry(self._segment(0), entry)
+
+    def _append_entry(self, segment, entry):
+        segment.index.write(json.dumps(entry, separators=(",", ":")) + "\n")
+        segment.index.flush()
+        self._index_entry(segment.name, entry)
+        self.dirty.add(segment.name)
+
+    def sync(self, dump_paths):
+        """一个段只需一次 fsync, 即覆盖其中此前追加的全部 dump; 文件形式的 dump 交给父类"""
+        with self.lock:
+            dirty, self.dirty = self.dirty, set()
+        files = [p for p in dump_paths if os.path.exists(self.resolve(p))]
+        # 按名字重新打开即可, fsync 刷的是文件本身而不是某个描述符
+        for name in dirty:
+            base = os.path.join(self.segment_dir, name)
+            fsync_path(base + ".seg")
+            fsync_path(base + ".idx")
+        if dirty:
+            fsync_path(self.segment_dir)
+        super().sync(files)
+
+    def lookup(self, dump_path):
+        """
+        返回最新一次写入的 (段名, offset, length, ts, metadata), 未登记时返回 None;
+        最新一次是文件形式时段名为 None
+        """
+        key = os.path.relpath(self.resolve(dump_path), self.root)
+        with self.lock:
+            self._refresh()
+            return self.index.get(key)
+
+    def read(self, dump_path):
+        location = self.lookup(dump_path)
+        if location is None or location[0] is None:
+            return super().read(dump_path)
+        name, offset, length = location[:3]
+        fd = os.open(os.path.join(self.segment_dir, name + ".seg"), os.O_RDONLY)
+        try:
+            data = os.pread(fd, length, offset)
+        finally:
+            os.close(fd)
+        if len(data) != length:
+            raise OSError(f"segment {name} truncated at {offset}+{length}")
+        return data
+
+    def entries(self, metadata=None):
+        """按 dump_path 排序返回 (dump_path, 位置), metadata 给出时只返回各键值都相同的 dump"""
+        match = (metadata or {}).items()
+        with self.lock:
+            self._refresh()
+            return sorted((key, location) for key, location in self.index.items()
+                          if all(location[4].get(k) == v for k, v in match))
+
+    def _segment(self, size):
+        segment = self.active
+        if segment is None or (segment.size and segment.size + size > self.segment_bytes):
+            if segment is not None:
+                segment.close()
+            segment = self.active = Segment(self.segment_dir)
+        return segment
+
+    def _refresh(self):
+        """读入所有索引文件新增的完整行, 其他进程写入的 dump 也由此可见"""
+        for name in os.listdir(self.segment_dir):
+            if not name.endswith(".idx"):
+                continue
+            path = os.path.join(self.segment_dir, name)
+            done = self.scanned.get(name, 0)
+            try:
+                if os.stat(path).st_size <= done:
+                    continue
+                with open(path, "rb") as f:
+                    f.seek(done)
+                    data = f.read()
+            except FileNotFoundError:
+                continue
+            end = data.rfind(b"\n") + 1
+            for line in data[:end].splitlines():
+                self._index_entry(name[:-len(".idx")], json.loads(line))
+            self.scanned[name] = done + end
+
+    def _index_entry(self, segment_name, entry):
+        current = self.index.get(entry["path"])
+        if current is None or current[3] <= entry["ts"]:
+            if entry.get("file"):
+                location = (None, 0, 0)
+            else:
+                location = (segment_name, entry["offset"], entry["length"])
+            self.index[entry["path"]] = location + (entry["ts"], entry.get("metadata", {}))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="list or read dumps kept in segments")
+    parser.add_argument("storage", help="dump storage root")
+    parser.add_argument("dump_path", nargs="?", help="write this dump to stdout")
+    parser.add_argument("-m", "--metadata", action="append", default=[], metavar="KEY=VALUE",
+                        help="list only dumps with this metadata (repeatable)")
+    args = parser.parse_args()
+
+    store = SegmentStore(args.storage)
+    if args.dump_path:
+        sys.stdout.buffer.write(store.read(args.dump_path))
+        return
+    match = dict(item.partition("=")[::2] for item in args.metadata)
+    for key, (name, offset, length, ts, metadata) in store.entries(match):
+        tags = ",".join(f"{k}={v}" for k, v in sorted(metadata.items()))
+        print(f"{key}\t{name or '-'}\t{offset}\t{length}\t{ts}\t{tags}")
+
+
+if __name__ == "__main__":
+    main()
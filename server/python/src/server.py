@@ -1,30 +1,645 @@
+import argparse
+import asyncio
 import grpc
+import multiprocessing
+import multiprocessing.connection
+import os
 from concurrent import futures
 import time
 from generated import dumptool_pb2
 from generated import dumptool_pb2_grpc
+from segments import SegmentStore
+from storage import DumpStore, NullStore
+from shm import ShmSegments
+from metrics import IngestStats, serve_text
+from convert import ConvertQueue
+from flamegraph import FlamegraphIndex
+import compression
+
+HIGH_WATER = 0.75
+MAX_BACKOFF_MS = 2000
+SESSION_CREDITS = 256  # 会话中客户端最多未确认的 dump 数
+
+class IngestQueue:
+    """
+    有界写入队列: 请求处理协程只把解压, 落盘等阻塞操作入队, 由固定数量的写入线程执行.
+    按排队的字节数和任务数限流, 超过高水位后按比例建议客户端退避.
+    """
+
+    def __init__(self, writers, max_bytes, max_jobs):
+        self.pool = futures.ThreadPoolExecutor(max_workers=writers,
+                                               thread_name_prefix="writer")
+        self.max_bytes = max_bytes
+        self.max_jobs = max_jobs
+        self.queued_bytes = 0
+        self.jobs = 0
+        self.drained = asyncio.Event()
+
+    def full(self, size):
+        if self.jobs == 0:
+            return False
+        return self.jobs >= self.max_jobs or self.queued_bytes + size > self.max_bytes
+
+    def submit_nowait(self, size, fn, *args):
+        """入队并返回 future, 队列已满时返回 None"""
+        if self.full(size):
+            return None
+        return self._submit(size, fn, *args)
+
+    async def submit(self, size, fn, *args):
+        """等到队列有空间再入队, 流式请求借此把背压传回客户端"""
+        while self.full(size):
+            self.drained.clear()
+            await self.drained.wait()
+        return self._submit(size, fn, *args)
+
+    async def run(self, size, fn, *args):
+        return await (await self.submit(size, fn, *args))
+
+    def _submit(self, size, fn, *args):
+        self.jobs += 1
+        self.queued_bytes += size
+        future = asyncio.get_running_loop().run_in_executor(self.pool, fn, *args)
+        future.add_done_callback(lambda _: self._release(size))
+        return future
+
+    def _release(self, size):
+        self.jobs -= 1
+        self.queued_bytes -= size
+        self.drained.set()
+
+    def retry_after_ms(self):
+        load = max(self.queued_bytes / self.max_bytes, self.jobs / self.max_jobs)
+        if load < HIGH_WATER:
+            return 0
+        return int(MAX_BACKOFF_MS * min(1.0, (load - HIGH_WATER) / (1 - HIGH_WATER)))
+
+class GroupCommit:
+    """
+    合并并发请求的 fsync: 第一个写完的 dump 开启 window 秒的窗口, 窗口结束或累计超过
+    max_bytes 时对其间写完的全部 dump 做一次 store.sync, 再一起应答. sync 进行期间
+    写完的 dump 进入下一批.
+    """
+
+    def __init__(self, store, window, max_bytes):
+        self.store = store
+        self.window = window
+        self.max_bytes = max_bytes
+        self.pool = futures.ThreadPoolExecutor(max_workers=1, thread_name_prefix="fsync")
+        self.paths = []
+        self.waiters = []
+        self.bytes = 0
+        self.pending = asyncio.Event()
+        self.full = asyncio.Event()
+        self.syncs = 0
+        self.dumps = 0
+
+    async def sync(self, dump_paths, size):
+        """等到 dump_paths 落到磁盘, sync 失败时抛出 OSError"""
+        future = asyncio.get_running_loop().create_future()
+        self.paths.extend(dump_paths)
+        self.waiters.append(future)
+        self.bytes += size
+        self.pending.set()
+        if self.bytes >= self.max_bytes:
+            self.full.set()
+        await future
+
+    async def run(self):
+        loop = asyncio.get_running_loop()
+        while True:
+            await self.pending.wait()
+            try:
+                await asyncio.wait_for(self.full.wait(), self.window)
+            except asyncio.TimeoutError:
+                pass
+            paths, waiters = self.paths, self.waiters
+            self.paths, self.waiters, self.bytes = [], [], 0
+            self.pending.clear()
+            self.full.clear()
+            error = None
+            try:
+                await loop.run_in_executor(self.pool, self.store.sync, paths)
+            except (ValueError, OSError) as e:
+                error = OSError(f"sync failed: {e}")
+            self.syncs += 1
+            self.dumps += len(paths)
+            for future in waiters:
+                if future.done():
+                    continue  # 请求已取消
+                if error:
+                    future.set_exception(error)
+                else:
+                    future.set_result(None)
 
 class DumpService(dumptool_pb2_grpc.DumpServiceServicer):
-    def SendDump(self, request, context):
+    def __init__(self, store, ingest, commit=None, converter=None, flamegraphs=None):
+        self.store = store
+        self.ingest = ingest
+        self.commit = commit
+        self.converter = converter
+        self.flamegraphs = flamegraphs
+        self.segments = ShmSegments()
+        self.stats = IngestStats()
+
+    async def SendDump(self, request, context):
+        trace = self.stats.begin(request)
+        response = None
+        try:
+            size = max(len(request.payload), request.raw_size)
+            future = self.ingest.submit_nowait(size, self._send_dump, request, trace)
+            if future is None:
+                trace.busy = True
+                response = self._busy()
+                return response
+            self.stats.enqueued(trace)
+            try:
+                response = await future
+            finally:
+                self.stats.dequeued(trace)
+            start = time.monotonic()
+            response = await self._durable(response, [request.dump_path], size)
+            if self.commit:
+                trace.fsync = time.monotonic() - start
+            response.retry_after_ms = self.ingest.retry_after_ms()
+            return response
+        finally:
+            self.stats.end(trace, response)
+
+    async def GetStats(self, request, context):
+        response = self.stats.to_proto(self.ingest, self.commit)
+        response.compressions.extend(compression.supported())
+        return response
+
+    async def QueryFlamegraph(self, request, context):
+        print(f"[Flamegraph] Job: {request.job}, ranks {list(request.ranks)}, "
+              f"stages {list(request.stages)}, steps [{request.step_begin}, {request.step_end}]")
+        if self.flamegraphs is None:
+            return dumptool_pb2.FlamegraphResponse(success=False,
+                                                   message="flamegraph queries are disabled")
+        if not request.job:
+            return dumptool_pb2.FlamegraphResponse(success=False, message="job is required")
+        # 解析与合并在写入线程中进行, 不阻塞事件循环
+        try:
+            response = await self.ingest.run(0, self.flamegraphs.query, request)
+        except (ValueError, OSError) as e:
+            return dumptool_pb2.FlamegraphResponse(success=False, message=str(e))
+        print(f"Flamegraph: {response.message}, {len(response.nodes)} of "
+              f"{response.total_nodes} nodes" + (" (cached)" if response.cached else ""))
+        return response
+
+    async def UploadDump(self, request_iterator, context):
+        response = await self._upload_dump(request_iterator)
+        response.retry_after_ms = self.ingest.retry_after_ms()
+        return response
+
+    async def SendShmDump(self, request, context):
+        # 段名由对端指定, 只接受同机 unix socket 上的请求
+        if not context.peer().startswith("unix:"):
+            return dumptool_pb2.DumpResponse(success=False,
+                                             message="shared memory requires a unix: endpoint")
+        future = self.ingest.submit_nowait(request.length, self._send_shm_dump, request)
+        if future is None:
+            return self._busy()
+        response = await self._durable(await future, [request.dump_path], request.length)
+        response.retry_after_ms = self.ingest.retry_after_ms()
+        return response
+
+    async def _durable(self, response, dump_paths, size):
+        # 开启 group commit 时, 写入成功的 dump 等 fsync 完成后才应答
+        if self.commit and response.success:
+            try:
+                await self.commit.sync(dump_paths, size)
+            except OSError as e:
+                response.success = False
+                response.message = str(e)
+        return response
+
+    def _busy(self):
+        # 只有繁忙时失败响应才带 retry_after_ms, 客户端据此区分可重发
+        return dumptool_pb2.DumpResponse(success=False, message="ingest queue full",
+                                         retry_after_ms=max(1, self.ingest.retry_after_ms()))
+
+    def _send_shm_dump(self, request):
+        print(f"[Shm Request] Path: {request.dump_path}")
+        print(f"Segment: {request.segment} [{request.offset}, +{request.length})")
+        log_metadata(request.metadata)
+        try:
+            with self.segments.view(request.segment, request.offset, request.length) as payload:
+                self.store.write(request.dump_path, payload, request.metadata)
+        except (ValueError, OSError) as e:
+            return dumptool_pb2.DumpResponse(success=False, message=str(e))
+        self._stored(request.dump_path, request.format, request.metadata, request.length)
+        return dumptool_pb2.DumpResponse(success=True, message="Hello! Request processed")
+
+    def _stored(self, dump_path, format, metadata, size):
+        # 只入队, 转换在后台进行, 不影响应答
+        if self.converter:
+            self.converter.submit(dump_path, dumptool_pb2.DumpRequest.DataFormat.Name(format),
+                                  metadata, size)
+        if self.flamegraphs:
+            self.flamegraphs.record(dump_path, metadata)
+
+    def _send_dump(self, request, trace=None):
+        started = time.monotonic()
         print(f"[Request] Path: {request.dump_path}")
         print(f"Format: {dumptool_pb2.DumpRequest.DataFormat.Name(request.format)}")
         print(f"Payload Size: {len(request.payload)} bytes")
+        log_metadata(request.metadata)
+        try:
+            start = time.thread_time()
+            decode_start = time.monotonic()
+            payload = compression.decompress(request.compression, request.payload, request.raw_size)
+            decode_cpu_us = int((time.thread_time() - start) * 1e6)
+            write_start = time.monotonic()
+            self.store.write(request.dump_path, payload, request.metadata)
+        except compression.UnsupportedCompression as e:
+            return dumptool_pb2.DumpResponse(success=False, message=str(e),
+                                             compression_unsupported=True)
+        except (ValueError, OSError) as e:
+            return dumptool_pb2.DumpResponse(success=False, message=str(e))
+        self._stored(request.dump_path, request.format, request.metadata, len(payload))
+        if trace:
+            trace.started = started
+            trace.decode = write_start - decode_start
+            trace.write = time.monotonic() - write_start
+            trace.raw_size = len(payload)
+        log_compression(request.compression, len(request.payload), len(payload), decode_cpu_us)
         return dumptool_pb2.DumpResponse(
             success=True,
-            message="Hello! Request processed"
+            message="Hello! Request processed",
+            decode_cpu_us=decode_cpu_us
         )
 
-def serve():
-    server = grpc.server(futures.ThreadPoolExecutor(max_workers=10))
-    dumptool_pb2_grpc.add_DumpServiceServicer_to_server(DumpService(), server)
-    server.add_insecure_port('[::]:50051')
-    server.start()
-    print("Server started on port 50051")
+    async def _upload_dump(self, request_iterator):
+        run = self.ingest.run
+        upload = None
+        wire_size = decode_cpu = 0
+        try:
+            async for chunk in request_iterator:
+                if upload is None:
+                    dump_path, total_size = chunk.dump_path, chunk.total_size
+                    format, metadata = chunk.format, dict(chunk.metadata)
+                    codec = chunk.compression
+                    print(f"[Upload] Path: {dump_path}")
+                    print(f"Format: {dumptool_pb2.DumpRequest.DataFormat.Name(chunk.format)}")
+                    print(f"Total Size: {total_size} bytes")
+                    log_metadata(chunk.metadata)
+                    striped = chunk.stripe_end > 0
+                    limit = chunk.stripe_end if striped else total_size
+                    if striped:
+                        print(f"Stripe: [{chunk.offset}, {chunk.stripe_end})")
+                        upload = await run(0, self.store.open_stripe, dump_path, chunk.upload_id,
+                                           total_size, chunk.offset, chunk.stripe_end, format,
+                                           metadata)
+                    else:
+                        upload = await run(0, self.store.open_upload, dump_path, chunk.upload_id,
+                                           total_size, metadata)
+                    if upload.size and not striped:
+                        print(f"Resuming {chunk.upload_id} at {upload.size} bytes")
+                if chunk.offset != upload.size:
+                    raise ValueError(f"unexpected offset {chunk.offset}, expected {upload.size}")
+                decode_cpu += await run(len(chunk.data), write_chunk, upload, codec, chunk.data,
+                                        limit)
+                wire_size += len(chunk.data)
+                if chunk.digest and not striped:
+                    if upload.size != total_size:
+                        raise ValueError(f"received {upload.size} of {total_size} bytes")
+                    if chunk.digest != upload.digest():
+                        await run(0, upload.discard)
+                        raise ValueError("digest mismatch")
+                    await run(0, upload.commit)
+                    if self.commit:
+                        await self.commit.sync([dump_path], upload.size)
+                    self._stored(dump_path, format, metadata, upload.size)
+                    print(f"Received {upload.size} bytes")
+                    log_compression(codec, wire_size, upload.size, int(decode_cpu * 1e6))
+                    return dumptool_pb2.DumpResponse(success=True, message="Upload complete",
+                                                     decode_cpu_us=int(decode_cpu * 1e6))
+            if upload is not None and striped:
+                await run(0, upload.abort)
+                if upload.size != limit:
+                    raise ValueError(f"stripe ended at {upload.size}, expected {limit}")
+                print(f"Stripe received up to {upload.size}")
+                log_compression(codec, wire_size, upload.size - upload.start, int(decode_cpu * 1e6))
+                return dumptool_pb2.DumpResponse(success=True, message="Stripe received",
+                                                 decode_cpu_us=int(decode_cpu * 1e6))
+            raise ValueError("stream ended without final digest")
+        except compression.UnsupportedCompression as e:
+            return dumptool_pb2.DumpResponse(success=False, message=str(e),
+                                             compression_unsupported=True)
+        except (ValueError, OSError) as e:
+            return dumptool_pb2.DumpResponse(success=False, message=str(e))
+        finally:
+            if upload is not None:
+                await run(0, upload.abort)
+
+    async def QueryUpload(self, request, context):
+        try:
+            status = await self.ingest.run(0, self.store.query_upload, request.upload_id)
+        except ValueError:
+            status = None
+        if status is None:
+            return dumptool_pb2.UploadStatus(found=False)
+        committed_size, total_size, ranges = status
+        return dumptool_pb2.UploadStatus(
+            found=True, committed_size=committed_size, total_size=total_size,
+            ranges=[dumptool_pb2.ByteRange(start=start, end=end) for start, end in ranges])
+
+    async def CommitUpload(self, request, context):
+        print(f"[Commit] Path: {request.dump_path}, upload {request.upload_id}")
+        try:
+            stored = await self.ingest.run(0, self.store.commit_stripes, request.dump_path,
+                                           request.upload_id, request.total_size, request.digest)
+            if self.commit:
+                await self.commit.sync([request.dump_path], request.total_size)
+        except (ValueError, OSError) as e:
+            return dumptool_pb2.DumpResponse(success=False, message=str(e))
+        if stored is not None:
+            self._stored(request.dump_path, *stored, request.total_size)
+        print(f"Committed {request.total_size} bytes")
+        return dumptool_pb2.DumpResponse(success=True, message="Upload complete")
+
+    async def DumpSession(self, request_iterator, context):
+        # 读取放在独立任务中, 已到达的 dump 一并入队, 全部写完后合并为一个确认
+        pending = asyncio.Queue()
+        reader = asyncio.create_task(read_session(request_iterator, pending))
+        print(f"[Session] Peer: {context.peer()}")
+        acked = failed = 0
+        credit = self._session_credits()
+        yield dumptool_pb2.SessionAck(acked=0, credit=credit)
+        closed = False
+        try:
+            while not closed:
+                batch = [await pending.get()]
+                while not pending.empty():
+                    batch.append(pending.get_nowait())
+                writes = []
+                traces = []
+                try:
+                    for request in batch:
+                        if request is None:
+                            closed = True
+                            break
+                        expected = acked + len(writes) + 1
+                        if request.seq != expected or request.seq > credit:
+                            await context.abort(grpc.StatusCode.FAILED_PRECONDITION,
+                                                f"unexpected seq {request.seq}, expected "
+                                                f"{expected}, credit {credit}")
+                        dump = request.dump
+                        trace = self.stats.begin(dump)
+                        traces.append((trace, None))
+                        future = await self.ingest.submit(max(len(dump.payload), dump.raw_size),
+                                                          self._send_dump, dump, trace)
+                        self.stats.enqueued(trace)
+                        future.add_done_callback(lambda _, trace=trace: self.stats.dequeued(trace))
+                        writes.append((request.seq, dump, trace, future))
+                    if not writes:
+                        continue
+                    failures = []
+                    written = []
+                    for i, (seq, dump, trace, future) in enumerate(writes):
+                        response = await future
+                        traces[i] = (trace, response)
+                        if response.success:
+                            written.append((seq, dump, response))
+                        else:
+                            failures.append((seq, response.message))
+                        acked = seq
+                    if self.commit and written:
+                        # 整批共用一次 fsync, 失败时整批报告
+                        start = time.monotonic()
+                        try:
+                            await self.commit.sync([dump.dump_path for _, dump, _ in written],
+                                                   sum(max(len(dump.payload), dump.raw_size)
+                                                       for _, dump, _ in written))
+                        except OSError as e:
+                            failures.extend((seq, str(e)) for seq, _, _ in written)
+                            for _, _, response in written:
+                                response.success = False
+                                response.message = str(e)
+                        else:
+                            fsync = time.monotonic() - start
+                            for trace, response in traces:
+                                if response.success:
+                                    trace.fsync = fsync
+                finally:
+                    # 与单个 SendDump 一样计入按格式的统计, 未等到结果的按失败计
+                    for trace, response in traces:
+                        self.stats.end(trace, response)
+                ack = dumptool_pb2.SessionAck()
+                for seq, message in sorted(failures):
+                    ack.failures.add(seq=seq, message=message)
+                failed += len(failures)
+                ack.acked = acked
+                ack.retry_after_ms = self.ingest.retry_after_ms()
+                credit = max(credit, acked + self._session_credits())
+                ack.credit = credit
+                yield ack
+        finally:
+            reader.cancel()
+        print(f"[Session] Closed after {acked} dumps ({failed} failed)")
+
+    def _session_credits(self):
+        # 处理队列繁忙时按建议的退避比例收缩额度, 至少保留一个
+        retry_after_ms = self.ingest.retry_after_ms()
+        return max(1, int(SESSION_CREDITS * (1 - retry_after_ms / MAX_BACKOFF_MS)))
+
+    async def ProbeDump(self, request, context):
+        print(f"[Probe] Path: {request.dump_path}")
+        print(f"Digest: {request.digest.hex()}, Size: {request.size} bytes")
+        log_metadata(request.metadata)
+        try:
+            present = await self.ingest.run(0, self.store.link_existing, request.dump_path,
+                                            request.digest, request.size, dict(request.metadata))
+        except (ValueError, OSError) as e:
+            return dumptool_pb2.ProbeResponse(present=False, message=str(e))
+        if not present:
+            return dumptool_pb2.ProbeResponse(present=False, message="Send payload")
+        self._stored(request.dump_path, request.format, request.metadata, request.size)
+        print(f"Dedup hit, linked {request.size} bytes")
+        return dumptool_pb2.ProbeResponse(present=True, message="Already stored")
+
+async def read_session(request_iterator, pending):
+    try:
+        async for request in request_iterator:
+            pending.put_nowait(request)
+    except grpc.RpcError:
+        pass  # 客户端断开, 按会话结束处理
+    finally:
+        pending.put_nowait(None)
+
+def write_chunk(upload, codec, data, limit):
+    """在写入线程中解压并追加一块, 返回解压耗费的 CPU 秒数"""
+    start = time.thread_time()
+    data = compression.decompress(codec, data, None, limit - upload.size)
+    decode_cpu = time.thread_time() - start
+    if upload.size + len(data) > limit:
+        upload.discard()
+        raise ValueError(f"payload exceeds end offset {limit}")
+    upload.write(data)
+    return decode_cpu
+
+def log_metadata(metadata):
+    # 客户端从 payload 提取的 type/pid/rank/step 也在其中, 无需解码 payload
+    for key, value in sorted(metadata.items()):
+        print(f"Metadata: {key}={value}")
+
+def log_compression(codec, wire_size, raw_size, decode_cpu_us):
+    if codec == dumptool_pb2.DumpRequest.NONE:
+        return
+    print(f"Compression: {compression.name(codec)}, {wire_size} -> {raw_size} bytes "
+          f"(saved {raw_size - wire_size}), decode {decode_cpu_us} us")
+
+async def serve_async(args, store, slot=0):
+    ingest = IngestQueue(args.workers, args.queue_mb * 1024 * 1024, args.queue_jobs)
+    commit = None
+    if args.fsync_ms is not None:
+        commit = GroupCommit(store, args.fsync_ms / 1000, args.fsync_mb * 1024 * 1024)
+        committer = asyncio.create_task(commit.run())
+    converter = None
+    if args.convert_workers > 0 and not args.sink:
+        converter = ConvertQueue(store, args.convert_workers, args.convert_queue,
+                                 args.convert_large_mb * 1024 * 1024)
+    # 多个工作进程各自监听同一端口, 由内核分配连接
+    server = grpc.aio.server(options=[("grpc.so_reuseport", 1)])
+    flamegraphs = None if args.sink else FlamegraphIndex(store, args.flamegraph_cache)
+    service = DumpService(store, ingest, commit, converter, flamegraphs)
+    dumptool_pb2_grpc.add_DumpServiceServicer_to_server(service, server)
+    server.add_insecure_port(f'[::]:{args.port}')
+    if args.unix:
+        server.add_insecure_port(f'unix:{args.unix}')
+    await server.start()
+    print(f"Server started on port {args.port}" + (f" and unix:{args.unix}" if args.unix else "")
+          + f" (pid {os.getpid()})")
+    if args.stats_port:
+        # 每个工作进程一个端口, 统计只覆盖本进程
+        port = args.stats_port + slot
+        await serve_text("127.0.0.1", port, lambda: service.stats.to_proto(ingest, commit))
+        print(f"Stats on http://127.0.0.1:{port}/")
+    try:
+        await server.wait_for_termination()
+    finally:
+        await server.stop(0)
+        ingest.pool.shutdown()
+        if converter:
+            converter.close()
+            print(f"Conversions: {converter.converted} done, {converter.failed} failed, "
+                  f"{converter.dropped} skipped")
+        if commit:
+            committer.cancel()
+            commit.pool.shutdown()
+            print(f"Group commit: {commit.dumps} dumps in {commit.syncs} syncs")
+
+def open_store(args):
+    if args.sink:
+        return NullStore()
+    if args.segments:
+        return SegmentStore(args.storage, args.segment_mb << 20)
+    return DumpStore(args.storage)
+
+def run_worker(args, slot=0):
+    # 存储只在启动进程中做一次维护, 工作进程直接打开; 同一 dump_path 的并发写入
+    # 各自写临时文件后原子替换, 续传和分条上传由文件锁在进程间互斥; 段存储下
+    # 每个进程追加自己的段文件
+    store = open_store(args)
+    try:
+        asyncio.run(serve_async(args, store, slot))
+    except KeyboardInterrupt:
+        pass
+
+def launch(args, processes):
+    """启动 processes 个工作进程共享端口, 意外退出的进程会被重新拉起"""
+    # grpc 初始化后不能安全 fork, 工作进程用 spawn 重新启动解释器
+    ctx = multiprocessing.get_context("spawn")
+    workers = {}
+    def start(slot):
+        worker = ctx.Process(target=run_worker, args=(args, slot),
+                             name=f"dumptool-{slot}")
+        worker.start()
+        workers[worker.sentinel] = (slot, worker)
+    for slot in range(processes):
+        start(slot)
+    print(f"Launched {processes} worker processes on port {args.port}")
     try:
         while True:
-            time.sleep(86400)
+            for sentinel in multiprocessing.connection.wait(list(workers)):
+                slot, worker = workers.pop(sentinel)
+                worker.join()
+                print(f"Worker {slot} (pid {worker.pid}) exited with code {worker.exitcode}, "
+                      "restarting")
+                time.sleep(1)
+                start(slot)
     except KeyboardInterrupt:
-        server.stop(0)
+        for _, worker in workers.values():
+            worker.terminate()
+        for _, worker in workers.values():
+            worker.join()
+
+def serve():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--port", type=int, default=50051)
+    parser.add_argument("--storage", default="dumps", help="dump storage root")
+    parser.add_argument("--processes", type=int, default=1,
+                        help="worker processes sharing the port with SO_REUSEPORT, "
+                             "0 for one per core")
+    parser.add_argument("--workers", type=int, default=10,
+                        help="writer threads (per process) that decompress and store "
+                             "queued payloads")
+    parser.add_argument("--queue-mb", type=int, default=256,
+                        help="payload bytes queued for the writers before new dumps are "
+                             "refused with a retry-after hint")
+    parser.add_argument("--queue-jobs", type=int, default=1024,
+                        help="queued writer jobs before new dumps are refused")
+    parser.add_argument("--upload-ttl", type=int, default=86400,
+                        help="seconds to keep interrupted uploads for resuming")
+    parser.add_argument("--fsync-ms", type=float, metavar="MS",
+                        help="acknowledge dumps only after fsync, batching the dumps written "
+                             "within this window into one sync (0 syncs as soon as the "
+                             "previous sync finishes)")
+    parser.add_argument("--fsync-mb", type=int, default=16,
+                        help="end the fsync window early once this many bytes are pending")
+    parser.add_argument("--stats-port", type=int, default=0,
+                        help="serve ingest metrics as text on 127.0.0.1 (worker N uses "
+                             "this port + N)")
+    parser.add_argument("--convert-workers", type=int, default=2,
+                        help="threads (per process) converting stored mem / timeline dumps "
+                             "into flamegraph / chrome JSON, 0 to disable")
+    parser.add_argument("--convert-queue", type=int, default=256,
+                        help="queued conversions before new ones are skipped")
+    parser.add_argument("--convert-large-mb", type=int, default=16,
+                        help="dumps above this size are converted by half of the workers "
+                             "only, so small ones keep flowing")
+    parser.add_argument("--flamegraph-cache", type=int, default=64,
+                        help="mem dumps whose parsed call trees are cached for "
+                             "QueryFlamegraph")
+    parser.add_argument("--segments", action="store_true",
+                        help="append whole dumps to large segment files with an index "
+                             "instead of one file per dump")
+    parser.add_argument("--segment-mb", type=int, default=256,
+                        help="roll to a new segment file past this size")
+    parser.add_argument("--unix", metavar="PATH",
+                        help="also listen on a unix socket, enabling shared-memory handoff")
+    parser.add_argument("--sink", action="store_true",
+                        help="decode and verify requests but discard the data (benchmarking)")
+    args = parser.parse_args()
+    processes = args.processes if args.processes > 0 else os.cpu_count()
+    if args.unix and processes > 1:
+        parser.error("--unix cannot be shared between processes, use --processes 1")
+
+    if args.sink:
+        print("Sink mode: payloads are not stored")
+    else:
+        store = open_store(args)
+        store.expire_uploads(args.upload_ttl)
+        removed = store.blobs.gc()
+        if removed:
+            print(f"Removed {removed} unreferenced blobs")
+
+    if processes == 1:
+        run_worker(args)
+    else:
+        launch(args, processes)
 
 if __name__ == '__main__':
-    serve()
\ No newline at end of file
+    serve()
@@ -0,0 +1,77 @@
+import collections
+import contextlib
+import mmap
+import os
+import re
+import stat
+import threading
+
+SHM_ROOT = "/dev/shm"
+# 客户端按 dumptool-<pid>-<十六进制> 命名, 不含 "/" 与 ".."
+SEGMENT_RE = re.compile(r"^dumptool-([0-9]{1,10})-[0-9a-f]{1,16}$")
+MAX_SEGMENTS = 64
+
+
+class ShmSegments:
+    """按段名缓存客户端共享内存环的只读映射, 段被重建(inode 或大小变化)时重新映射"""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.maps = collections.OrderedDict()
+
+    @contextlib.contextmanager
+    def view(self, name, offset, length):
+        mm = self._map(name)
+        if offset + length > len(mm):
+            raise ValueError(f"range [{offset}, +{length}) outside segment {name}")
+        view = memoryview(mm)[offset:offset + length]
+        try:
+            yield view
+        finally:
+            view.release()
+
+    def _map(self, name):
+        match = SEGMENT_RE.match(name)
+        if not match:
+            raise ValueError(f"invalid shm segment: {name!r}")
+        path = os.path.join(SHM_ROOT, name)
+        st = os.stat(path, follow_symlinks=False)
+        check_owner(name, int(match.group(1)), st)
+        key = (st.st_ino, st.st_size, st.st_uid)
+        with self.lock:
+            cached = self.maps.get(name)
+            if cached and cached[0] == key:
+                self.maps.move_to_end(name)
+                return cached[1]
+            fd = os.open(path, os.O_RDONLY | os.O_NOFOLLOW | os.O_CLOEXEC)
+            try:
+                # 检查之后段可能被替换, 映射的必须是检查过的那个文件
+                st = os.fstat(fd)
+                if (st.st_ino, st.st_size, st.st_uid) != key:
+                    raise ValueError(f"shm segment {name} changed while mapping")
+                mm = mmap.mmap(fd, 0, prot=mmap.PROT_READ)
+            finally:
+                os.close(fd)
+            # 旧映射可能仍被其他线程的 memoryview 引用, 交给 GC 回收, 不显式 close
+            self.maps[name] = (key, mm)
+            self.maps.move_to_end(name)
+            while len(self.maps) > MAX_SEGMENTS:
+                self.maps.popitem(last=False)
+            return mm
+
+
+def check_owner(name, pid, st):
+    """
+    gRPC 不提供对端的 SO_PEERCRED, 改为 fstat 校验段本身: 须属于名字中的进程所在的用户,
+    且只有该用户可读写 (客户端以 0600 创建). 谁能连接 unix socket 仍由其文件权限决定.
+    """
+    if not stat.S_ISREG(st.st_mode):
+        raise ValueError(f"shm segment {name} is not a regular file")
+    if st.st_mode & 0o077:
+        raise ValueError(f"shm segment {name} is accessible to other users")
+    try:
+        owner = os.stat(f"/proc/{pid}").st_uid
+    except FileNotFoundError:
+        raise ValueError(f"shm segment {name}: process {pid} not running") from None
+    if st.st_uid != owner:
+        raise ValueError(f"shm segment {name} is not owned by the user of process {pid}")
@@ -0,0 +1,493 @@
+import fcntl
+import hashlib
+import json
+import os
+import re
+import tempfile
+import threading
+import time
+
+UPLOAD_DIR = ".uploads"
+BLOB_DIR = ".blobs"
+ARTIFACT_DIR = ".artifacts"
+UPLOAD_ID_RE = re.compile(r"^[A-Za-z0-9_-]{1,128}$")
+READ_STEP = 4 * 1024 * 1024
+STRIPE_SYNC_BYTES = 64 * 1024 * 1024
+
+
+class DumpStore:
+    def __init__(self, root):
+        self.root = os.path.abspath(root)
+        self.upload_dir = os.path.join(self.root, UPLOAD_DIR)
+        os.makedirs(self.upload_dir, exist_ok=True)
+        self.blobs = BlobStore(os.path.join(self.root, BLOB_DIR))
+        self.artifact_dir = os.path.join(self.root, ARTIFACT_DIR)
+
+    def resolve(self, dump_path):
+        # dump_path 一律视为 root 下的相对路径, 不允许逃出 root 或进入内部目录
+        path = os.path.normpath(os.path.join(self.root, dump_path.lstrip("/")))
+        if path == self.root or not path.startswith(self.root + os.sep):
+            raise ValueError(f"invalid dump_path: {dump_path!r}")
+        for internal in (self.upload_dir, self.blobs.root, self.artifact_dir):
+            if path == internal or path.startswith(internal + os.sep):
+                raise ValueError(f"invalid dump_path: {dump_path!r}")
+        return path
+
+    def write(self, dump_path, payload, metadata=None):
+        upload = self.open_upload(dump_path)
+        try:
+            upload.write(payload)
+            return upload.commit()
+        except BaseException:
+            upload.abort()
+            raise
+
+    def read(self, dump_path):
+        with open(self.resolve(dump_path), "rb") as f:
+            return f.read()
+
+    def sync(self, dump_paths):
+        """把已写完的 dump 及其目录项刷到磁盘, 同一目录只 fsync 一次"""
+        dirs = set()
+        for dump_path in dump_paths:
+            path = self.resolve(dump_path)
+            fsync_path(path)
+            dirs.add(os.path.dirname(path))
+        for dirname in dirs:
+            fsync_path(dirname)
+
+    def open_upload(self, dump_path, upload_id="", total_size=0, metadata=None):
+        if not upload_id:
+            return PartialFile(self.blobs, self.resolve(dump_path))
+        return ResumableUpload(self.blobs, self.resolve(dump_path),
+                               self._upload_base(upload_id), total_size)
+
+    def link_existing(self, dump_path, digest, size, metadata=None):
+        """内容已存在时把 dump_path 链接到对应 blob 并返回 True"""
+        return self.blobs.link(digest, size, self.resolve(dump_path))
+
+    def open_stripe(self, dump_path, upload_id, total_size, start, end, format=0,
+                    metadata=None):
+        return StripedUpload(self.resolve(dump_path), self._upload_base(upload_id),
+                             total_size, start, end, format, metadata)
+
+    def query_upload(self, upload_id):
+        """返回 (已提交字节数, 总大小, 分条上传已写入的区间), 不存在时返回 None"""
+        base = self._upload_base(upload_id)
+        try:
+            with open(base + ".json") as f:
+                meta = json.load(f)
+            if meta.get("striped"):
+                ranges = meta["ranges"]
+                return sum(end - start for start, end in ranges), meta["total_size"], ranges
+            return os.stat(base + ".part").st_size, meta["total_size"], []
+        except (FileNotFoundError, ValueError, KeyError):
+            return None
+
+    def commit_stripes(self, dump_path, upload_id, total_size, digest):
+        """
+        所有条带到齐后校验整体摘要并提交, 返回上传时记录的 (format, metadata);
+        重复提交已完成的上传视为成功, 返回 None
+        """
+        path = self.resolve(dump_path)
+        base = self._upload_base(upload_id)
+        with StripeMeta(base) as meta:
+            if meta.data is None:
+                if self.blobs.is_linked(digest, path):
+                    return None
+                raise ValueError(f"unknown upload {upload_id!r}")
+            if meta.data["dump_path"] != path or meta.data["total_size"] != total_size:
+                raise ValueError(f"upload {upload_id!r} parameters mismatch")
+            ranges = meta.data["ranges"]
+            if ranges != [[0, total_size]]:
+                received = sum(end - start for start, end in ranges)
+                raise ValueError(f"incomplete upload: {received} of {total_size} bytes")
+
+            sha256 = hashlib.sha256()
+            with open(base + ".part", "rb") as f:
+                while True:
+                    data = f.read(READ_STEP)
+                    if not data:
+                        break
+                    sha256.update(data)
+            if sha256.digest() != digest:
+                os.unlink(base + ".part")
+                meta.remove()
+                raise ValueError("digest mismatch")
+            self.blobs.publish(base + ".part", digest, path)
+            stored = meta.data.get("format", 0), meta.data.get("metadata", {})
+            meta.remove()
+        return stored
+
+    def expire_uploads(self, max_age):
+        """清理超过 max_age 秒未更新的续传残留"""
+        deadline = time.time() - max_age
+        for name in os.listdir(self.upload_dir):
+            path = os.path.join(self.upload_dir, name)
+            try:
+                if os.stat(path).st_mtime < deadline:
+                    os.unlink(path)
+            except FileNotFoundError:
+                pass
+
+    def _upload_base(self, upload_id):
+        if not UPLOAD_ID_RE.match(upload_id):
+            raise ValueError(f"invalid upload_id: {upload_id!r}")
+        return os.path.join(self.upload_dir, upload_id)
+
+
+class NullStore:
+    """压测用的替身: 请求照常解码和校验, 但数据不落盘"""
+
+    def write(self, dump_path, payload, metadata=None):
+        return dump_path
+
+    def sync(self, dump_paths):
+        pass
+
+    def open_upload(self, dump_path, upload_id="", total_size=0, metadata=None):
+        return NullUpload(dump_path)
+
+    def query_upload(self, upload_id):
+        return None
+
+    def link_existing(self, dump_path, digest, size, metadata=None):
+        return False
+
+    def open_stripe(self, dump_path, upload_id, total_size, start, end, format=0,
+                    metadata=None):
+        if not start < end <= total_size:
+            raise ValueError(f"invalid stripe [{start}, {end}) of {total_size} bytes")
+        return NullUpload(dump_path, start)
+
+    def commit_stripes(self, dump_path, upload_id, total_size, digest):
+        # 条带数据未保存, 无从校验摘要; 没有写入任何内容, 也不触发转换
+        return None
+
+
+class NullUpload:
+    def __init__(self, path, start=0):
+        self.path = path
+        self.start = self.size = start
+        self.sha256 = hashlib.sha256()
+
+    def write(self, data):
+        self.sha256.update(data)
+        self.size += len(data)
+
+    def digest(self):
+        return self.sha256.digest()
+
+    def commit(self):
+        return self.path
+
+    def abort(self):
+        pass
+
+    def discard(self):
+        pass
+
+
+class BlobStore:
+    """
+    按 SHA-256 寻址的内容存储, blob 位于 .blobs/<前两位>/<hex>,
+    dump_path 以硬链接指向 blob, 相同内容只落盘一份.
+    """
+
+    def __init__(self, root):
+        self.root = root
+        os.makedirs(root, exist_ok=True)
+
+    def path(self, digest):
+        if len(digest) != hashlib.sha256().digest_size:
+            raise ValueError(f"invalid digest length {len(digest)}")
+        name = digest.hex()
+        return os.path.join(self.root, name[:2], name)
+
+    def publish(self, tmp_path, digest, target):
+        """把写完的临时文件收入 blob 存储, 内容已存在时丢弃临时文件"""
+        blob = self.path(digest)
+        os.makedirs(os.path.dirname(blob), exist_ok=True)
+        try:
+            os.link(tmp_path, blob)
+        except FileExistsError:
+            pass
+        os.unlink(tmp_path)
+        self._link_to(blob, target)
+
+    def link(self, digest, size, target):
+        blob = self.path(digest)
+        try:
+            if os.stat(blob).st_size != size:
+                return False
+            self._link_to(blob, target)
+        except FileNotFoundError:
+            return False
+        return True
+
+    def is_linked(self, digest, target):
+        try:
+            return os.path.samefile(self.path(digest), target)
+        except FileNotFoundError:
+            return False
+
+    def gc(self):
+        """删除已没有任何 dump_path 引用的 blob, 返回删除的个数"""
+        removed = 0
+        for dirpath, _, names in os.walk(self.root):
+            for name in names:
+                path = os.path.join(dirpath, name)
+                try:
+                    if os.stat(path).st_nlink == 1:
+                        os.unlink(path)
+                        removed += 1
+                except FileNotFoundError:
+                    pass
+        return removed
+
+    @staticmethod
+    def _link_to(blob, target):
+        dirname, basename = os.path.split(target)
+        os.makedirs(dirname, exist_ok=True)
+        tmp = os.path.join(dirname, f".{basename}.{os.getpid()}.{threading.get_ident()}.link")
+        try:
+            os.unlink(tmp)
+        except FileNotFoundError:
+            pass
+        os.link(blob, tmp)
+        os.replace(tmp, target)
+
+
+class PartialFile:
+    """写入临时文件, commit 时收入 blob 存储并原子地链接到目标路径"""
+
+    on_commit = None  # 提交后以目标路径调用, 供 SegmentStore 登记
+
+    def __init__(self, blobs, path):
+        self.blobs = blobs
+        self.path = path
+        dirname, basename = os.path.split(path)
+        os.makedirs(dirname, exist_ok=True)
+        fd, self.tmp_path = tempfile.mkstemp(prefix=f".{basename}.", suffix=".part", dir=dirname)
+        os.fchmod(fd, 0o644)
+        self.file = os.fdopen(fd, "wb")
+        self.size = 0
+        self.sha256 = hashlib.sha256()
+        self.committed = False
+
+    def write(self, data):
+        self.file.write(data)
+        self.sha256.update(data)
+        self.size += len(data)
+
+    def digest(self):
+        return self.sha256.digest()
+
+    def commit(self):
+        self.file.close()
+        self.blobs.publish(self.tmp_path, self.digest(), self.path)
+        self.committed = True
+        if self.on_commit:
+            self.on_commit(self.path)
+        return self.path
+
+    def abort(self):
+        if self.committed:
+            return
+        self.file.close()
+        try:
+            os.unlink(self.tmp_path)
+        except FileNotFoundError:
+            pass
+
+    def discard(self):
+        self.abort()
+
+
+class ResumableUpload(PartialFile):
+    """
+    续传的暂存文件位于 .uploads/<upload_id>.part, 连接中断时保留,
+    下次以相同 upload_id 打开时从已写入的位置继续.
+    """
+
+    def __init__(self, blobs, path, base, total_size):
+        self.blobs = blobs
+        self.path = path
+        self.tmp_path = base + ".part"
+        self.meta_path = base + ".json"
+        self.committed = False
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+
+        fd = os.open(self.tmp_path, os.O_RDWR | os.O_CREAT, 0o644)
+        try:
+            fcntl.flock(fd, fcntl.LOCK_EX | fcntl.LOCK_NB)
+        except BlockingIOError:
+            os.close(fd)
+            raise ValueError(f"upload {os.path.basename(base)} already in progress")
+        self.file = os.fdopen(fd, "r+b")
+
+        meta = {"dump_path": path, "total_size": total_size}
+        try:
+            with open(self.meta_path) as f:
+                resumable = json.load(f) == meta
+        except (FileNotFoundError, ValueError):
+            resumable = False
+        if not resumable:
+            self.file.truncate(0)
+            with open(self.meta_path, "w") as f:
+                json.dump(meta, f)
+
+        # 重新计算已写入部分的摘要
+        self.size = 0
+        self.sha256 = hashlib.sha256()
+        while True:
+            data = self.file.read(READ_STEP)
+            if not data:
+                break
+            self.sha256.update(data)
+            self.size += len(data)
+
+    def write(self, data):
+        super().write(data)
+        self.file.flush()
+
+    def commit(self):
+        path = super().commit()
+        self._unlink(self.meta_path)
+        return path
+
+    def abort(self):
+        """保留已写入部分以便续传"""
+        if self.committed or self.file.closed:
+            return
+        self.file.flush()
+        os.fsync(self.file.fileno())
+        self.file.close()
+
+    def discard(self):
+        if not self.file.closed:
+            self.file.close()
+        self._unlink(self.tmp_path)
+        self._unlink(self.meta_path)
+
+    @staticmethod
+    def _unlink(path):
+        try:
+            os.unlink(path)
+        except FileNotFoundError:
+            pass
+
+
+def fsync_path(path):
+    fd = os.open(path, os.O_RDONLY)
+    try:
+        os.fsync(fd)
+    finally:
+        os.close(fd)
+
+
+def add_range(ranges, start, end):
+    """把 [start, end) 并入有序且互不相交的区间列表"""
+    merged = []
+    for s, e in sorted(ranges + [[start, end]]):
+        if merged and s <= merged[-1][1]:
+            merged[-1][1] = max(merged[-1][1], e)
+        else:
+            merged.append([s, e])
+    return merged
+
+
+class StripeMeta:
+    """分条上传的区间记录, 读改写期间持有 <upload_id>.lock 上的 flock, 线程和进程间互斥"""
+
+    def __init__(self, base):
+        self.path = base + ".json"
+        self.lock_path = base + ".lock"
+
+    def __enter__(self):
+        self.fd = os.open(self.lock_path, os.O_RDWR | os.O_CREAT, 0o644)
+        fcntl.flock(self.fd, fcntl.LOCK_EX)
+        try:
+            with open(self.path) as f:
+                self.data = json.load(f)
+        except (FileNotFoundError, ValueError):
+            self.data = None
+        return self
+
+    def __exit__(self, *exc):
+        os.close(self.fd)
+
+    def save(self):
+        tmp = self.path + ".tmp"
+        with open(tmp, "w") as f:
+            json.dump(self.data, f)
+        os.replace(tmp, self.path)
+
+    def remove(self):
+        self.data = None
+        try:
+            os.unlink(self.path)
+        except FileNotFoundError:
+            pass
+
+
+class StripedUpload:
+    """
+    多条带并行上传中的一个条带: 各条带流按绝对偏移写入同一个暂存文件
+    .uploads/<upload_id>.part, 写入的区间落盘后合并记录到 <upload_id>.json.
+    size 为本条带下一个待写入的绝对偏移.
+    """
+
+    def __init__(self, path, base, total_size, start, end, format=0, metadata=None):
+        if not start < end <= total_size:
+            raise ValueError(f"invalid stripe [{start}, {end}) of {total_size} bytes")
+        self.base = base
+        self.start = self.size = self.synced = start
+        self.closed = False
+        part = base + ".part"
+        with StripeMeta(base) as meta:
+            expect = {"dump_path": path, "total_size": total_size, "striped": True}
+            if meta.data is None or any(meta.data.get(k) != v for k, v in expect.items()):
+                # 新的上传或参数变化, 重建暂存文件
+                self.fd = os.open(part, os.O_RDWR | os.O_CREAT | os.O_TRUNC, 0o644)
+                os.ftruncate(self.fd, total_size)
+                # format 与 metadata 留到提交时用于入库后的转换和登记
+                meta.data = dict(expect, ranges=[], format=format, metadata=dict(metadata or {}))
+                meta.save()
+            else:
+                self.fd = os.open(part, os.O_RDWR)
+
+    def write(self, data):
+        view = memoryview(data)
+        while view:
+            n = os.pwrite(self.fd, view, self.size)
+            view = view[n:]
+            self.size += n
+        if self.size - self.synced >= STRIPE_SYNC_BYTES:
+            self._record()
+
+    def _record(self):
+        if self.size == self.synced:
+            return
+        os.fdatasync(self.fd)
+        with StripeMeta(self.base) as meta:
+            if meta.data is not None:
+                meta.data["ranges"] = add_range(meta.data["ranges"], self.synced, self.size)
+                meta.save()
+        self.synced = self.size
+
+    def abort(self):
+        """记录已写入的区间以便续传"""
+        if self.closed:
+            return
+        try:
+            self._record()
+        finally:
+            os.close(self.fd)
+            self.closed = True
+
+    def discard(self):
+        """丢弃本条带未记录的数据, 不影响其他条带"""
+        if not self.closed:
+            os.close(self.fd)
+            self.closed = True